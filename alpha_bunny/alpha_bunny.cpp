@@ -5,41 +5,56 @@
 #include <CGAL/Alpha_shape_vertex_base_3.h>
 #include <CGAL/Alpha_shape_cell_base_3.h>
 #include <CGAL/Triangulation_data_structure_3.h>
+#include <CGAL/Triangulation_vertex_base_with_info_3.h>
 
+#include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "imgui.h"
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_opengl3.h"
 
+#include "alpha_spectrum_index.h"
+#include "background_job.h"
+#include "gl_buffers.h"
+#include "lod_points.h"
+#include "point_cache.h"
+
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <vector>
 #include <string>
+#include <cstring>
 #include <algorithm>
+#include <memory>
+#include <cstdint>
 
 typedef CGAL::Exact_predicates_inexact_constructions_kernel Kernel_t;
-typedef CGAL::Alpha_shape_vertex_base_3<Kernel_t> Vb_t;
+typedef CGAL::Triangulation_vertex_base_with_info_3<unsigned int, Kernel_t> Vbi_t; // info = index into points
+typedef CGAL::Alpha_shape_vertex_base_3<Kernel_t, Vbi_t> Vb_t;
 typedef CGAL::Alpha_shape_cell_base_3<Kernel_t> Cb_t;
-typedef CGAL::Triangulation_data_structure_3<Vb_t, Cb_t> Tds_t;
+// With TBB the TDS is concurrency-safe; insertion only runs in parallel
+// when a lock data structure is attached (see BuildAlphaShape)
+#ifdef CGAL_LINKED_WITH_TBB
+typedef CGAL::Triangulation_data_structure_3<Vb_t, Cb_t, CGAL::Parallel_tag> Tds_t;
+#else
+typedef CGAL::Triangulation_data_structure_3<Vb_t, Cb_t, CGAL::Sequential_tag> Tds_t;
+#endif
 typedef CGAL::Delaunay_triangulation_3<Kernel_t, Tds_t> Delaunay_t;
 typedef CGAL::Alpha_shape_3<Delaunay_t> Alpha_shape_3;
 // typedef CGAL::Alpha_shape_3<Delaunay_t, CGAL::Tag_true> Alpha_shape_3;
 typedef Kernel_t::Point_3 Point;
+typedef AlphaSpectrumIndex<Alpha_shape_3> AlphaIndex_t;
 
+// Load through the binary point cache (<file>.pcache), written on first load
 std::vector<Point> LoadCSV(const std::string &filename)
 {
-    std::ifstream file(filename);
     std::vector<Point> pts;
-    std::string line;
-    while (std::getline(file, line))
-    {
-        std::stringstream ss(line);
-        float x, y, z;
-        char comma;
-        if (ss >> x >> comma >> y >> comma >> z)
-            pts.push_back({x, y, z});
-    }
+    PointCache cache;
+    if (!cache.Load(filename) || cache.channels() < 3) return pts;
+
+    const float *x = cache.channel(0), *y = cache.channel(1), *z = cache.channel(2);
+    pts.reserve(cache.size());
+    for (std::size_t i = 0; i < cache.size(); ++i)
+        pts.emplace_back(x[i], y[i], z[i]);
     return pts;
 }
 
@@ -80,61 +95,110 @@ std::vector<Point> NormalizePoints(std::vector<Point> &pts)
     return norm_pts;
 }
 
-std::vector<Point> BuildAlpha(const std::vector<Point> &pts, const double & alpha)
+// Build the alpha shape (and its underlying 3D Delaunay triangulation) once per point set.
+// In GENERAL mode the whole alpha spectrum is precomputed, so later alpha changes
+// only need set_alpha() to re-classify facets.
+// Each vertex stores its index into pts so facets can be emitted as index buffers.
+// pts must be normalized to the unit cube when parallel is set (bounds of the lock grid).
+std::unique_ptr<Alpha_shape_3> BuildAlphaShape(const std::vector<Point> &pts, bool parallel = false)
 {
-    if (pts.empty()) return {};
+    if (pts.empty()) return nullptr;
 
-    std::vector<Point> lines;
+    std::vector<std::pair<Point, unsigned int>> indexed;
+    indexed.reserve(pts.size());
+    for (unsigned int i = 0; i < pts.size(); ++i)
+        indexed.emplace_back(pts[i], i);
 
-    Alpha_shape_3 A(pts.begin(), pts.end(), alpha, Alpha_shape_3::GENERAL);
+    Delaunay_t dt;
+#ifdef CGAL_LINKED_WITH_TBB
+    Delaunay_t::Lock_data_structure lock_grid(CGAL::Bbox_3(-0.5, -0.5, -0.5, 0.5, 0.5, 0.5), 50);
+    if (parallel) dt.set_lock_data_structure(&lock_grid);
+#endif
+    dt.insert(indexed.begin(), indexed.end());
+#ifdef CGAL_LINKED_WITH_TBB
+    dt.set_lock_data_structure(nullptr);
+#endif
+    auto A = std::make_unique<Alpha_shape_3>(dt, 0, Alpha_shape_3::GENERAL); // takes over dt
+    std::cout << "Alpha shape: " << A->number_of_vertices() << " vertices | "
+              << A->number_of_alphas() << " alpha values" << std::endl;
+    return A;
+}
 
-    for (auto it = A.alpha_shape_facets_begin(); it != A.alpha_shape_facets_end(); ++it)
-    {
-        auto cell = it->first; // cell handle
-        int i = it->second; // opposite vertex
+// Look up the boundary facets at alpha in the spectrum index and return their edges
+// as pairs of indices into pts. Edges shared by adjacent facets are emitted once.
+std::vector<std::uint32_t> BuildAlpha(const AlphaIndex_t &index, const double & alpha)
+{
+    const std::vector<std::uint32_t> tris = index.facets_at(alpha);
 
-        // gather the 3 vertices of this facet
-        std::vector<Point> pts;
-        for (int j = 0; j < 4; ++j)
+    // pack each edge as (min << 32 | max) so sort + unique removes duplicates
+    std::vector<std::uint64_t> keys;
+    keys.reserve(tris.size());
+    for (std::size_t t = 0; t < tris.size(); t += 3)
+    {
+        for (int k = 0; k < 3; ++k)
         {
-            if (j == i) continue;
-            pts.push_back(cell->vertex(j)->point());
+            std::uint64_t a = tris[t + k];
+            std::uint64_t b = tris[t + (k + 1) % 3];
+            if (a > b) std::swap(a, b);
+            keys.push_back((a << 32) | b);
         }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
 
-        // Create and store 3 edges of the triangle
-        lines.push_back(pts[0]); lines.push_back(pts[1]); // first vertex of the triangle
-        lines.push_back(pts[1]); lines.push_back(pts[2]); // second vertex of the triangle
-        lines.push_back(pts[2]); lines.push_back(pts[0]); // thrird vertex of the triangle
+    std::vector<std::uint32_t> edges;
+    edges.reserve(keys.size() * 2);
+    for (std::uint64_t key : keys)
+    {
+        edges.push_back(static_cast<std::uint32_t>(key >> 32));
+        edges.push_back(static_cast<std::uint32_t>(key & 0xffffffffu));
     }
 
-    std::cout << "Alpha: " << alpha << " | edges: " << lines.size() / 2 << std::endl;
-    return lines;
+    std::cout << "Alpha: " << alpha << " | edges: " << edges.size() / 2 << std::endl;
+    return edges;
 }
 
-// Render helpers
-void DrawLines(const std::vector<Point> &lines)
+// One alpha recomputation on the worker thread
+struct AlphaRequest
 {
-    glBegin(GL_LINES);
-    for (auto &p : lines)
-        glVertex3f(p.x(), p.y(), p.z());
-    glEnd();
+    float alpha = 0.0f;
+    bool optimal = false; // ignore alpha and use optimal_alpha(1)
+};
+
+struct AlphaResult
+{
+    float alpha = 0.0f;
+    std::vector<std::uint32_t> edges; // index pairs into points
+};
+
+// Render helpers, geometry lives in buffer objects (see gl_buffers.h)
+void DrawLines(const GeometryBuffer &points_gpu)
+{
+    points_gpu.DrawElements(GL_LINES);
 }
 
-void DrawPoints(const std::vector<Point> &pts)
+// points go through the LOD octree, only the nodes selected for the view are drawn
+void DrawPoints(LodPoints &lod_points)
 {
     glPointSize(3.0f);
-    glBegin(GL_POINTS);
-    for (auto &p : pts)
-        glVertex3f(p.x(), p.y(), p.z());
-    glEnd();
+    lod_points.Draw();
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+    bool parallel_build = false;
+    for (int i = 1; i < argc; ++i)
+        if (std::strcmp(argv[i], "--parallel") == 0) parallel_build = true;
+#ifndef CGAL_LINKED_WITH_TBB
+    if (parallel_build) std::cerr << "built without TBB, --parallel ignored" << std::endl;
+    parallel_build = false;
+#endif
+
     if (!glfwInit()) return -1;
 
     GLFWwindow *window = glfwCreateWindow(800, 600, "stanford bunny - alpha shapes", nullptr, nullptr);
     glfwMakeContextCurrent(window);
+    gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
 
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -148,7 +212,34 @@ int main()
     bool recompute = true;
     auto points = std::move(NormalizePoints(data));
 
-    std::vector<Point> alpha_edges;
+    // points are uploaded once, alpha edges are index pairs into them
+    const std::vector<float> xyz = FlattenPoints3(points);
+    GeometryBuffer points_gpu;
+    points_gpu.SetVertices(xyz);
+    LodPoints lod_points;
+    lod_points.Build(xyz);
+
+    // triangulate once and sort facets by their alpha interval,
+    // the alpha slider then only does a lookup in the spectrum index.
+    // Both live on the worker thread: the first job builds them.
+    std::unique_ptr<Alpha_shape_3> alpha_shape;
+    std::unique_ptr<AlphaIndex_t> alpha_index;
+    BackgroundJob<AlphaRequest, AlphaResult> alpha_job(
+        [&](const AlphaRequest &request, const JobToken &token)
+        {
+            AlphaResult result;
+            if (!alpha_index)
+            {
+                alpha_shape = BuildAlphaShape(points, parallel_build);
+                if (!alpha_shape) return result;
+                alpha_index = std::make_unique<AlphaIndex_t>(*alpha_shape);
+            }
+            if (token.Cancelled()) return result;
+            result.alpha = request.optimal ? (float)alpha_index->optimal_alpha(1) : request.alpha;
+            result.edges = BuildAlpha(*alpha_index, result.alpha);
+            return result;
+        });
+    AlphaResult alpha_edges; // front buffer, swapped in when the worker is done
 
     while (!glfwWindowShouldClose(window))
     {
@@ -158,13 +249,18 @@ int main()
 
         if (recompute)
         {
-            alpha_edges = BuildAlpha(points, alpha);
+            alpha_job.Submit({alpha, false});
             recompute = false;
         }
+        if (alpha_job.Poll(alpha_edges))
+        {
+            alpha = alpha_edges.alpha;
+            points_gpu.SetIndices(alpha_edges.edges);
+        }
 
-        DrawPoints(points);
+        DrawPoints(lod_points);
         if (show_alpha)
-            DrawLines(alpha_edges);
+            DrawLines(points_gpu);
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -175,14 +271,20 @@ int main()
         {
             recompute = true;
         }
-        ImGui::Text("#points: %zu", points.size());
-        ImGui::Text("#edges: %zu", alpha_edges.size() / 2);
+        if (ImGui::Button("optimal alpha"))
+            alpha_job.Submit({alpha, true});
+        ImGui::Text("#points: %zu (drawn %zu)", points.size(), lod_points.drawn());
+        ImGui::Text("#edges: %zu", alpha_edges.edges.size() / 2);
+        if (alpha_job.Busy())
+            ImGui::Text("computing...");
 
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
         glfwSwapBuffers(window);
     }
 
+    points_gpu.Release();
+    lod_points.Release();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -0,0 +1,122 @@
+#pragma once
+
+// Facet index over the alpha spectrum of an Alpha_shape_3 (GENERAL mode).
+//
+// A facet belongs to the alpha shape boundary (SINGULAR or REGULAR) for every
+// alpha in [lo, hi), where
+//   lo = alpha_min if the facet is Gabriel, alpha_mid otherwise
+//   hi = alpha_max, or +inf if the facet lies on the convex hull
+//
+// Facets are sorted by lo once, so facets_at(alpha) is a binary search for the
+// prefix with lo <= alpha, followed by a walk down a max-tree over hi that only
+// visits subtrees containing at least one facet with hi > alpha.
+// Cost is O(k log n) for k output facets instead of a pass over every facet.
+//
+// Vertex indices come from vertex->info(), so the vertex base must carry an
+// integer info (Triangulation_vertex_base_with_info_3).
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+template <class AlphaShape>
+class AlphaSpectrumIndex
+{
+public:
+    explicit AlphaSpectrumIndex(const AlphaShape &A) : A_(A)
+    {
+        struct Entry { double lo, hi; std::uint32_t v[3]; };
+        std::vector<Entry> entries;
+        entries.reserve(A.number_of_finite_facets());
+
+        for (auto fit = A.finite_facets_begin(); fit != A.finite_facets_end(); ++fit)
+        {
+            auto cell = fit->first;
+            int i = fit->second; // opposite vertex
+            auto as = cell->get_facet_status(i);
+
+            Entry e;
+            e.lo = as->is_Gabriel() ? as->alpha_min() : as->alpha_mid();
+            e.hi = as->is_on_chull() ? std::numeric_limits<double>::infinity() : as->alpha_max();
+
+            int k = 0;
+            for (int j = 0; j < 4; ++j)
+            {
+                if (j == i) continue;
+                e.v[k++] = static_cast<std::uint32_t>(cell->vertex(j)->info());
+            }
+            entries.push_back(e);
+        }
+
+        std::sort(entries.begin(), entries.end(),
+                  [](const Entry &a, const Entry &b) { return a.lo < b.lo; });
+
+        const std::size_t n = entries.size();
+        lo_.resize(n);
+        hi_.resize(n);
+        triangles_.resize(3 * n);
+        for (std::size_t f = 0; f < n; ++f)
+        {
+            lo_[f] = entries[f].lo;
+            hi_[f] = entries[f].hi;
+            std::copy(entries[f].v, entries[f].v + 3, triangles_.begin() + 3 * f);
+        }
+
+        // max-tree over hi, leaves padded to a power of two
+        leaves_ = 1;
+        while (leaves_ < n) leaves_ *= 2;
+        max_hi_.assign(2 * leaves_, -std::numeric_limits<double>::infinity());
+        std::copy(hi_.begin(), hi_.end(), max_hi_.begin() + leaves_);
+        for (std::size_t node = leaves_ - 1; node > 0; --node)
+            max_hi_[node] = std::max(max_hi_[2 * node], max_hi_[2 * node + 1]);
+    }
+
+    std::size_t size() const { return lo_.size(); }
+
+    // Triangle index buffer (3 vertex indices per facet) of the SINGULAR and
+    // REGULAR facets at the given alpha. Safe to call concurrently.
+    std::vector<std::uint32_t> facets_at(double alpha) const
+    {
+        std::vector<std::uint32_t> out;
+        const std::size_t prefix = std::upper_bound(lo_.begin(), lo_.end(), alpha) - lo_.begin();
+        if (prefix > 0)
+            Collect(1, 0, leaves_, prefix, alpha, out);
+        return out;
+    }
+
+    // Smallest alpha of the spectrum for which the shape has at most
+    // nb_components solid components and no data point is exterior.
+    double optimal_alpha(int nb_components = 1) const
+    {
+        auto it = A_.find_optimal_alpha(nb_components);
+        if (it != A_.alpha_end()) return *it;
+        return A_.alpha_begin() != A_.alpha_end() ? *std::prev(A_.alpha_end()) : 0.0;
+    }
+
+private:
+    void Collect(std::size_t node, std::size_t node_begin, std::size_t node_end,
+                 std::size_t prefix, double alpha, std::vector<std::uint32_t> &out) const
+    {
+        if (node_begin >= prefix || max_hi_[node] <= alpha) return;
+
+        if (node >= leaves_) // leaf == one facet
+        {
+            const std::size_t f = node - leaves_;
+            out.insert(out.end(), triangles_.begin() + 3 * f, triangles_.begin() + 3 * f + 3);
+            return;
+        }
+
+        const std::size_t mid = (node_begin + node_end) / 2;
+        Collect(2 * node, node_begin, mid, prefix, alpha, out);
+        Collect(2 * node + 1, mid, node_end, prefix, alpha, out);
+    }
+
+    const AlphaShape &A_;
+    std::vector<double> lo_;                // sorted ascending
+    std::vector<double> hi_;                // same order as lo_
+    std::vector<std::uint32_t> triangles_;  // same order as lo_
+    std::vector<double> max_hi_;            // implicit binary tree, root at 1
+    std::size_t leaves_ = 1;
+};
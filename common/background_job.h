@@ -0,0 +1,114 @@
+#pragma once
+
+// Single background worker for interactive recomputation.
+//
+// Submit() hands new parameters to the worker. Parameters that have not been
+// picked up yet are simply replaced, and a job that is already running sees
+// its JobToken report Cancelled() so it can bail out between stages; its
+// result is dropped either way. Results are double-buffered: the worker fills
+// a back buffer and Poll() swaps it into the caller's front buffer on the
+// render thread, so nothing is locked while drawing.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+class JobToken
+{
+public:
+    JobToken(const std::atomic<std::uint64_t> &latest, std::uint64_t id) : latest_(latest), id_(id) {}
+
+    // true once newer parameters have been submitted
+    bool Cancelled() const { return latest_.load(std::memory_order_relaxed) != id_; }
+
+private:
+    const std::atomic<std::uint64_t> &latest_;
+    std::uint64_t id_;
+};
+
+template <class Params, class Result>
+class BackgroundJob
+{
+public:
+    using Work = std::function<Result(const Params &, const JobToken &)>;
+
+    explicit BackgroundJob(Work work) : work_(std::move(work)), worker_([this] { Run(); }) {}
+
+    ~BackgroundJob()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+            ++latest_; // cancel the running job, if any
+        }
+        cv_.notify_one();
+        worker_.join();
+    }
+
+    BackgroundJob(const BackgroundJob &) = delete;
+    BackgroundJob &operator=(const BackgroundJob &) = delete;
+
+    void Submit(Params params)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_ = std::move(params);
+            ++latest_;
+        }
+        cv_.notify_one();
+    }
+
+    // Swap the newest finished result into front. Returns false if there is nothing new.
+    bool Poll(Result &front)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!back_ready_) return false;
+        std::swap(front, back_);
+        back_ready_ = false;
+        return true;
+    }
+
+    // true while submitted parameters have not produced a result yet
+    bool Busy() const { return finished_.load() != latest_.load(); }
+
+private:
+    void Run()
+    {
+        for (;;)
+        {
+            std::optional<Params> params;
+            std::uint64_t id;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stop_ || pending_.has_value(); });
+                if (stop_) return;
+                params.swap(pending_);
+                id = latest_.load();
+            }
+
+            Result result = work_(*params, JobToken(latest_, id));
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (id != latest_.load()) continue; // superseded while running
+            back_ = std::move(result);
+            back_ready_ = true;
+            finished_ = id;
+        }
+    }
+
+    Work work_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::optional<Params> pending_;
+    Result back_{};
+    bool back_ready_ = false;
+    bool stop_ = false;
+    std::atomic<std::uint64_t> latest_{0};   // id of the newest submitted parameters
+    std::atomic<std::uint64_t> finished_{0}; // id of the newest delivered result
+    std::thread worker_;                     // last, starts after everything above is set up
+};
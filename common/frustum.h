@@ -0,0 +1,39 @@
+#pragma once
+
+// View frustum planes extracted from a column-major model-view-projection
+// matrix (Gribb/Hartmann), normalized so plane distances are in model units.
+
+#include <cmath>
+
+struct Frustum
+{
+    float planes[6][4]; // a x + b y + c z + d >= 0 inside
+
+    explicit Frustum(const float m[16])
+    {
+        auto row = [&](int r, int c) { return m[c * 4 + r]; };
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                planes[2 * i][c] = row(3, c) + row(i, c);
+                planes[2 * i + 1][c] = row(3, c) - row(i, c);
+            }
+        }
+        for (int i = 0; i < 6; ++i)
+        {
+            float *p = planes[i];
+            const float len = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+            if (len > 0.0f)
+                for (int c = 0; c < 4; ++c) p[c] /= len;
+        }
+    }
+
+    bool SphereVisible(const float center[3], float radius) const
+    {
+        for (int i = 0; i < 6; ++i)
+            if (planes[i][0] * center[0] + planes[i][1] * center[1] + planes[i][2] * center[2] + planes[i][3] < -radius)
+                return false;
+        return true;
+    }
+};
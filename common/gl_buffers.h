@@ -0,0 +1,167 @@
+#pragma once
+
+// GPU-resident geometry for the fixed-function viewers.
+//
+// Points and lines are uploaded into buffer objects once, and again only when
+// the geometry changes, then drawn with a single glDrawArrays/glDrawElements
+// call. Vertices go through client-state vertex arrays, so the legacy matrix
+// stack (glFrustum, glOrtho, glLoadMatrixf) and glColor keep working. Only
+// GL 1.5 buffer objects are needed, so this runs on any compatibility
+// context, Mesa's llvmpipe/softpipe included.
+//
+// Include before GLFW (glad must come first) and call gladLoadGLLoader()
+// once the context is current. Release() must run while the context is alive.
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class GeometryBuffer
+{
+public:
+    GeometryBuffer() = default;
+    ~GeometryBuffer() { Release(); }
+
+    GeometryBuffer(const GeometryBuffer &) = delete;
+    GeometryBuffer &operator=(const GeometryBuffer &) = delete;
+
+    // Upload count vertices of dims (2 or 3) floats each, replacing the previous ones
+    void SetVertices(const float *data, std::size_t count, int dims = 3)
+    {
+        if (!vbo_) glGenBuffers(1, &vbo_);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+        glBufferData(GL_ARRAY_BUFFER, count * dims * sizeof(float), count ? data : nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        n_vertices_ = count;
+        dims_ = dims;
+    }
+
+    void SetVertices(const std::vector<float> &data, int dims = 3)
+    {
+        SetVertices(data.data(), data.size() / dims, dims);
+    }
+
+    // Upload an index list into the vertices (e.g. pairs for GL_LINES)
+    void SetIndices(const std::uint32_t *data, std::size_t count)
+    {
+        if (!ibo_) glGenBuffers(1, &ibo_);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(std::uint32_t), count ? data : nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        n_indices_ = count;
+    }
+
+    void SetIndices(const std::vector<std::uint32_t> &data) { SetIndices(data.data(), data.size()); }
+
+    // Draw the first count vertices (all by default) as mode
+    void DrawArrays(GLenum mode, std::size_t count = SIZE_MAX) const
+    {
+        count = count < n_vertices_ ? count : n_vertices_;
+        if (count == 0) return;
+        Bind();
+        glDrawArrays(mode, 0, static_cast<GLsizei>(count));
+        Unbind();
+    }
+
+    // Draw the first count indices (all by default) as mode
+    void DrawElements(GLenum mode, std::size_t count = SIZE_MAX) const
+    {
+        count = count < n_indices_ ? count : n_indices_;
+        if (count == 0 || n_vertices_ == 0) return;
+        Bind();
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_);
+        glDrawElements(mode, static_cast<GLsizei>(count), GL_UNSIGNED_INT, nullptr);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        Unbind();
+    }
+
+    // Draw several vertex ranges in one call (e.g. a PointOctree selection)
+    void DrawRanges(GLenum mode, const std::vector<GLint> &first, const std::vector<GLsizei> &count) const
+    {
+        if (first.empty() || n_vertices_ == 0) return;
+        Bind();
+        glMultiDrawArrays(mode, first.data(), count.data(), static_cast<GLsizei>(first.size()));
+        Unbind();
+    }
+
+    void Release()
+    {
+        if (vbo_) glDeleteBuffers(1, &vbo_);
+        if (ibo_) glDeleteBuffers(1, &ibo_);
+        vbo_ = ibo_ = 0;
+        n_vertices_ = n_indices_ = 0;
+    }
+
+    std::size_t vertex_count() const { return n_vertices_; }
+    std::size_t index_count() const { return n_indices_; }
+
+private:
+    void Bind() const
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glVertexPointer(dims_, GL_FLOAT, 0, nullptr);
+    }
+
+    void Unbind() const
+    {
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    GLuint vbo_ = 0;
+    GLuint ibo_ = 0;
+    std::size_t n_vertices_ = 0;
+    std::size_t n_indices_ = 0;
+    int dims_ = 3;
+};
+
+// Current fixed-function model-view-projection (column-major) and the focal
+// length in pixels (projection[1][1] * viewport height / 2), for LOD selection
+inline void CurrentView(float mvp[16], float &focal_px)
+{
+    float p[16], m[16];
+    GLint viewport[4];
+    glGetFloatv(GL_PROJECTION_MATRIX, p);
+    glGetFloatv(GL_MODELVIEW_MATRIX, m);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r)
+        {
+            float v = 0.0f;
+            for (int k = 0; k < 4; ++k) v += p[k * 4 + r] * m[c * 4 + k];
+            mvp[c * 4 + r] = v;
+        }
+    focal_px = p[5] * viewport[3] * 0.5f;
+}
+
+// Flatten any range of points with x(), y(), z() into xyz floats
+template <class Points>
+std::vector<float> FlattenPoints3(const Points &pts)
+{
+    std::vector<float> xyz;
+    xyz.reserve(3 * pts.size());
+    for (const auto &p : pts)
+    {
+        xyz.push_back(static_cast<float>(p.x()));
+        xyz.push_back(static_cast<float>(p.y()));
+        xyz.push_back(static_cast<float>(p.z()));
+    }
+    return xyz;
+}
+
+// Same for 2D points
+template <class Points>
+std::vector<float> FlattenPoints2(const Points &pts)
+{
+    std::vector<float> xy;
+    xy.reserve(2 * pts.size());
+    for (const auto &p : pts)
+    {
+        xy.push_back(static_cast<float>(p.x()));
+        xy.push_back(static_cast<float>(p.y()));
+    }
+    return xy;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// Point cloud drawn through a PointOctree: the points are uploaded once in
+// octree order and every frame only the nodes selected for the current view
+// and point budget are drawn, with one glMultiDrawArrays call. Per-frame CPU
+// cost depends on the number of octree nodes, not on the number of points.
+// Uses the fixed-function matrices, see gl_buffers.h.
+
+#include "gl_buffers.h"
+#include "point_octree.h"
+
+#include <cstddef>
+#include <vector>
+
+class LodPoints
+{
+public:
+    explicit LodPoints(std::size_t moving_budget = 1000000, std::size_t max_budget = 8000000)
+        : budget_(moving_budget, max_budget) {}
+
+    // xyz: n interleaved points normalized to the unit cube
+    void Build(const float *xyz, std::size_t n)
+    {
+        octree_.Build(xyz, n);
+        gpu_.SetVertices(octree_.Reorder(xyz, 3));
+    }
+
+    void Build(const std::vector<float> &xyz) { Build(xyz.data(), xyz.size() / 3); }
+
+    // Pick the nodes to draw for the current matrices, growing the budget while the view is still
+    const PointOctree::Selection &Select()
+    {
+        float mvp[16], focal_px;
+        CurrentView(mvp, focal_px);
+        selection_ = octree_.Select(mvp, focal_px, budget_.Update(mvp));
+        return selection_;
+    }
+
+    void Draw()
+    {
+        Select();
+        gpu_.DrawRanges(GL_POINTS, selection_.first, selection_.count);
+    }
+
+    void Release() { gpu_.Release(); }
+
+    const PointOctree &octree() const { return octree_; }
+    const PointOctree::Selection &selection() const { return selection_; }
+    std::size_t drawn() const { return selection_.points; }
+
+private:
+    PointOctree octree_;
+    GeometryBuffer gpu_;
+    LodBudget budget_;
+    PointOctree::Selection selection_;
+};
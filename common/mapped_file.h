@@ -0,0 +1,110 @@
+#pragma once
+
+// Read-only view of a whole file. Uses mmap on POSIX systems so large inputs
+// are paged in on demand instead of being copied through iostreams; elsewhere
+// the file is read into memory once.
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Size and modification time of a file, used to tell whether a cache derived from it is stale.
+// mtime is in nanoseconds where the platform has them, so a rewrite within the same second shows.
+inline bool FileStamp(const std::string &filename, std::uint64_t &size, std::int64_t &mtime)
+{
+    struct stat st;
+    if (::stat(filename.c_str(), &st) != 0) return false;
+    size = static_cast<std::uint64_t>(st.st_size);
+    mtime = static_cast<std::int64_t>(st.st_mtime) * 1000000000;
+#if defined(__APPLE__)
+    mtime += static_cast<std::int64_t>(st.st_mtimespec.tv_nsec);
+#elif !defined(_WIN32)
+    mtime += static_cast<std::int64_t>(st.st_mtim.tv_nsec);
+#endif
+    return true;
+}
+
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &filename) { Open(filename); }
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool Open(const std::string &filename)
+    {
+        Close();
+#ifndef _WIN32
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ > 0)
+        {
+            void *addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED)
+            {
+                ::close(fd);
+                size_ = 0;
+                return false;
+            }
+            ::madvise(addr, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char *>(addr);
+        }
+        ::close(fd); // the mapping stays valid
+        open_ = true;
+        return true;
+#else
+        std::ifstream in(filename, std::ios::binary | std::ios::ate);
+        if (!in) return false;
+        buffer_.resize(static_cast<std::size_t>(in.tellg()));
+        in.seekg(0);
+        in.read(buffer_.data(), buffer_.size());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+        open_ = true;
+        return true;
+#endif
+    }
+
+    void Close()
+    {
+#ifndef _WIN32
+        if (data_) ::munmap(const_cast<char *>(data_), size_);
+#else
+        buffer_.clear();
+#endif
+        data_ = nullptr;
+        size_ = 0;
+        open_ = false;
+    }
+
+    bool is_open() const { return open_; }
+    const char *data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+private:
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+    bool open_ = false;
+#ifdef _WIN32
+    std::vector<char> buffer_;
+#endif
+};
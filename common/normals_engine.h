@@ -0,0 +1,551 @@
+#pragma once
+
+// Normal estimation and orientation on contiguous storage with one shared kd-tree.
+//
+// The kd-tree is built once and queried (in parallel) for every point's
+// neighborhood: its k nearest neighbors, or all neighbors within a radius
+// (optionally capped to the k nearest). The neighbor lists are kept in CSR
+// form and reused by
+//  - AverageSpacing()  mean distance to the neighbors
+//  - EstimateNormals() PCA (smallest eigenvector of the covariance) or jet
+//                      fitting (Monge_via_jet_fitting); VCM goes through
+//                      CGAL::vcm_estimate_normals, which builds its own structures
+//  - OrientNormals()   minimum spanning tree propagation over the neighbor graph
+//                      (weights 1 - |n_i . n_j|, seeded at the highest point with
+//                      its normal facing +z), as mst_orient_normals does; for large
+//                      clouds per tile in parallel, then reconciled across tiles
+// Jet and VCM need Eigen (CGAL_EIGEN3_ENABLED).
+
+#include <CGAL/Search_traits_3.h>
+#include <CGAL/Search_traits_adapter.h>
+#include <CGAL/Orthogonal_k_neighbor_search.h>
+#include <CGAL/Fuzzy_sphere.h>
+#include <CGAL/property_map.h>
+#include <CGAL/Default_diagonalize_traits.h>
+#include <boost/iterator/counting_iterator.hpp>
+#ifdef CGAL_EIGEN3_ENABLED
+#include <CGAL/Monge_via_jet_fitting.h>
+#include <CGAL/vcm_estimate_normals.h>
+#endif
+
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+enum class NormalEstimator
+{
+    PCA,
+    Jet,
+    VCM
+};
+
+inline bool ParseNormalEstimator(const std::string &name, NormalEstimator &estimator)
+{
+    if (name == "pca") estimator = NormalEstimator::PCA;
+    else if (name == "jet") estimator = NormalEstimator::Jet;
+    else if (name == "vcm") estimator = NormalEstimator::VCM;
+    else return false;
+    return true;
+}
+
+// k nearest neighbors, or all within radius (radius > 0), capped to the k nearest if k > 0
+struct Neighborhood
+{
+    unsigned k = 18;
+    double radius = 0.0;
+};
+
+template <class Kernel>
+class NormalsEngine
+{
+public:
+    typedef typename Kernel::FT FT;
+    typedef typename Kernel::Point_3 Point;
+    typedef typename Kernel::Vector_3 Vector;
+
+    explicit NormalsEngine(std::vector<Point> points, unsigned threads = 0)
+            : points_(std::move(points)), normals_(points_.size(), Vector(0, 0, 0)), threads_(threads) {}
+
+    // Build the kd-tree and every point's neighbor list
+    void BuildNeighborhoods(const Neighborhood &hood)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const std::size_t n = points_.size();
+        Point_map_t point_map(points_.data());
+        Tree_t tree(boost::counting_iterator<std::size_t>(0), boost::counting_iterator<std::size_t>(n),
+                    typename Tree_t::Splitter(), Traits_t(point_map));
+        tree.build(); // queries below run concurrently on the finished tree
+
+        std::vector<std::vector<std::uint32_t>> lists(n);
+        ParallelFor(n, threads_, [&](std::size_t begin, std::size_t end)
+        {
+            std::vector<std::size_t> found;
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                std::vector<std::uint32_t> &list = lists[i];
+                if (hood.radius > 0.0)
+                {
+                    found.clear();
+                    Sphere_t sphere(points_[i], hood.radius, 0, tree.traits());
+                    tree.search(std::back_inserter(found), sphere);
+                    found.erase(std::remove(found.begin(), found.end(), i), found.end());
+                    if (hood.k > 0 && found.size() > hood.k)
+                    {
+                        auto closer = [&](std::size_t a, std::size_t b)
+                        {
+                            return CGAL::squared_distance(points_[i], points_[a]) <
+                                   CGAL::squared_distance(points_[i], points_[b]);
+                        };
+                        std::nth_element(found.begin(), found.begin() + hood.k, found.end(), closer);
+                        found.resize(hood.k);
+                    }
+                    list.assign(found.begin(), found.end());
+                }
+                else
+                {
+                    Knn_t search(tree, points_[i], hood.k + 1, 0, true, Distance_t(point_map));
+                    for (auto it = search.begin(); it != search.end(); ++it)
+                        if (it->first != i) list.push_back(static_cast<std::uint32_t>(it->first));
+                    if (list.size() > hood.k) list.resize(hood.k);
+                }
+            }
+        });
+
+        offsets_.assign(n + 1, 0);
+        for (std::size_t i = 0; i < n; ++i) offsets_[i + 1] = offsets_[i] + lists[i].size();
+        neighbors_.resize(offsets_[n]);
+        for (std::size_t i = 0; i < n; ++i)
+            std::copy(lists[i].begin(), lists[i].end(), neighbors_.begin() + offsets_[i]);
+        Report("neighborhoods", start);
+    }
+
+    double AverageSpacing() const
+    {
+        double sum = 0.0;
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < points_.size(); ++i)
+            for (std::size_t a = offsets_[i]; a < offsets_[i + 1]; ++a)
+            {
+                sum += std::sqrt(CGAL::to_double(CGAL::squared_distance(points_[i], points_[neighbors_[a]])));
+                ++count;
+            }
+        return count ? sum / count : 0.0;
+    }
+
+    // Unoriented normals; returns false if the estimator is not available in this build.
+    // Points with too few neighbors for the estimator get a zero normal and are left unoriented.
+    bool EstimateNormals(NormalEstimator estimator)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        switch (estimator)
+        {
+        case NormalEstimator::PCA:
+            ParallelFor(points_.size(), threads_, [&](std::size_t b, std::size_t e) { EstimatePCA(b, e); });
+            break;
+        case NormalEstimator::Jet:
+#ifdef CGAL_EIGEN3_ENABLED
+            ParallelFor(points_.size(), threads_, [&](std::size_t b, std::size_t e) { EstimateJet(b, e); });
+            break;
+#else
+            std::cerr << "jet fitting needs Eigen" << std::endl;
+            return false;
+#endif
+        case NormalEstimator::VCM:
+#ifdef CGAL_EIGEN3_ENABLED
+            EstimateVCM();
+            break;
+#else
+            std::cerr << "VCM needs Eigen" << std::endl;
+            return false;
+#endif
+        }
+        Report("normal estimation", start);
+        return true;
+    }
+
+    // Orient normals consistently; returns the number of points left unoriented
+    // (zero normal, or not connected to the seed in the neighbor graph).
+    // tile_points > 0 splits the cloud into tiles of at most that many points (median splits along
+    // the longest axis). Every tile grows its own minimum spanning forest in parallel; the forests'
+    // components are then reconciled along a maximum spanning tree of the small component graph,
+    // whose edges carry the sum of n_i . n_j over the neighbor pairs crossing tile borders.
+    // With a single tile this is the plain MST propagation.
+    std::size_t OrientNormals(std::size_t tile_points = 0)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const std::size_t n = points_.size();
+        oriented_.assign(n, 0);
+        if (n == 0) return 0;
+
+        std::vector<std::size_t> adj_offsets;
+        std::vector<std::uint32_t> adjacency;
+        SymmetricAdjacency(adj_offsets, adjacency);
+
+        // zero normals (too few neighbors) carry no orientation, they are neither oriented nor propagated through
+        std::vector<char> valid(n);
+        for (std::size_t i = 0; i < n; ++i) valid[i] = normals_[i] != CGAL::NULL_VECTOR;
+
+        std::vector<std::uint32_t> order;       // point indices grouped by tile
+        std::vector<std::size_t> tile_offsets;  // tile t = order[tile_offsets[t], tile_offsets[t + 1])
+        SplitTiles(tile_points > 0 ? tile_points : n, order, tile_offsets);
+        const std::size_t n_tiles = tile_offsets.size() - 1;
+        std::vector<std::uint32_t> tile_of(n);
+        for (std::size_t t = 0; t < n_tiles; ++t)
+            for (std::size_t k = tile_offsets[t]; k < tile_offsets[t + 1]; ++k) tile_of[order[k]] = t;
+
+        // Prim inside every tile: grow along the most parallel normals, flipping to agree with the parent.
+        // component[i] is numbered per tile first, made global below.
+        const std::uint32_t none = 0xffffffffu;
+        std::vector<std::uint32_t> component(n, none);
+        std::vector<std::uint32_t> tile_components(n_tiles, 0);
+        ParallelFor(n_tiles, threads_, [&](std::size_t first_tile, std::size_t last_tile)
+        {
+            typedef std::pair<double, std::pair<std::uint32_t, std::uint32_t>> Edge_t; // weight, (parent, child)
+            std::priority_queue<Edge_t, std::vector<Edge_t>, std::greater<Edge_t>> queue;
+            for (std::size_t t = first_tile; t < last_tile; ++t)
+            {
+                auto push_edges = [&](std::uint32_t i)
+                {
+                    for (std::size_t a = adj_offsets[i]; a < adj_offsets[i + 1]; ++a)
+                    {
+                        const std::uint32_t j = adjacency[a];
+                        if (tile_of[j] != t || component[j] != none || !valid[j]) continue;
+                        const double w = 1.0 - std::abs(CGAL::to_double(normals_[i] * normals_[j]));
+                        queue.push({w, {i, j}});
+                    }
+                };
+                std::uint32_t components = 0;
+                for (std::size_t k = tile_offsets[t]; k < tile_offsets[t + 1]; ++k)
+                {
+                    if (component[order[k]] != none || !valid[order[k]]) continue;
+                    component[order[k]] = components;
+                    push_edges(order[k]);
+                    while (!queue.empty())
+                    {
+                        const auto edge = queue.top();
+                        queue.pop();
+                        const std::uint32_t parent = edge.second.first, child = edge.second.second;
+                        if (component[child] != none) continue;
+                        if (normals_[parent] * normals_[child] < 0) normals_[child] = -normals_[child];
+                        component[child] = components;
+                        push_edges(child);
+                    }
+                    ++components;
+                }
+                tile_components[t] = components;
+            }
+        }, 1);
+
+        std::vector<std::uint32_t> component_base(n_tiles + 1, 0);
+        for (std::size_t t = 0; t < n_tiles; ++t) component_base[t + 1] = component_base[t] + tile_components[t];
+        const std::size_t n_components = component_base[n_tiles];
+        for (std::size_t i = 0; i < n; ++i)
+            if (component[i] != none) component[i] += component_base[tile_of[i]];
+
+        // inter-tile votes: (component a, component b, n_a . n_b), each border edge counted from the lower tile
+        struct Vote
+        {
+            std::uint32_t a, b;
+            double dot;
+            bool operator<(const Vote &o) const { return a != o.a ? a < o.a : b < o.b; }
+        };
+        std::vector<std::vector<Vote>> tile_votes(n_tiles);
+        ParallelFor(n_tiles, threads_, [&](std::size_t first_tile, std::size_t last_tile)
+        {
+            for (std::size_t t = first_tile; t < last_tile; ++t)
+                for (std::size_t k = tile_offsets[t]; k < tile_offsets[t + 1]; ++k)
+                {
+                    const std::uint32_t i = order[k];
+                    for (std::size_t a = adj_offsets[i]; a < adj_offsets[i + 1]; ++a)
+                    {
+                        const std::uint32_t j = adjacency[a];
+                        if (tile_of[j] <= t || component[i] == none || component[j] == none) continue;
+                        tile_votes[t].push_back({component[i], component[j], CGAL::to_double(normals_[i] * normals_[j])});
+                    }
+                }
+        }, 1);
+        std::vector<Vote> votes;
+        for (auto &v : tile_votes) votes.insert(votes.end(), v.begin(), v.end());
+        tile_votes.clear();
+        std::sort(votes.begin(), votes.end());
+        std::size_t merged = 0;
+        for (std::size_t v = 0; v < votes.size(); ++v)
+        {
+            if (merged > 0 && votes[merged - 1].a == votes[v].a && votes[merged - 1].b == votes[v].b)
+                votes[merged - 1].dot += votes[v].dot;
+            else
+                votes[merged++] = votes[v];
+        }
+        votes.resize(merged);
+
+        // component graph (CSR, both directions)
+        std::vector<std::size_t> graph_offsets(n_components + 1, 0);
+        for (const Vote &v : votes)
+        {
+            ++graph_offsets[v.a + 1];
+            ++graph_offsets[v.b + 1];
+        }
+        for (std::size_t c = 0; c < n_components; ++c) graph_offsets[c + 1] += graph_offsets[c];
+        std::vector<std::pair<std::uint32_t, double>> graph(graph_offsets[n_components]);
+        {
+            std::vector<std::size_t> fill(graph_offsets.begin(), graph_offsets.end() - 1);
+            for (const Vote &v : votes)
+            {
+                graph[fill[v.a]++] = {v.b, v.dot};
+                graph[fill[v.b]++] = {v.a, v.dot};
+            }
+        }
+
+        // seed: highest point with a normal, its normal faces up
+        std::size_t seed = n;
+        for (std::size_t i = 0; i < n; ++i)
+            if (valid[i] && (seed == n || points_[i].z() > points_[seed].z())) seed = i;
+        if (seed == n) return n;
+
+        // Prim over components on the vote strength; flip[c] = component c disagrees with the seed
+        std::vector<char> reached(n_components, 0), flip(n_components, 0);
+        typedef std::pair<double, std::pair<std::uint32_t, std::uint32_t>> Link_t; // |vote|, (parent, child)
+        std::priority_queue<Link_t> queue;
+        auto push_links = [&](std::uint32_t c)
+        {
+            for (std::size_t a = graph_offsets[c]; a < graph_offsets[c + 1]; ++a)
+                if (!reached[graph[a].first]) queue.push({std::abs(graph[a].second), {c, graph[a].first}});
+        };
+        const std::uint32_t seed_component = component[seed];
+        reached[seed_component] = 1;
+        flip[seed_component] = normals_[seed].z() < 0;
+        push_links(seed_component);
+        while (!queue.empty())
+        {
+            const auto link = queue.top();
+            queue.pop();
+            const std::uint32_t parent = link.second.first, child = link.second.second;
+            if (reached[child]) continue;
+            double vote = 0.0;
+            for (std::size_t a = graph_offsets[parent]; a < graph_offsets[parent + 1]; ++a)
+                if (graph[a].first == child) vote = graph[a].second;
+            reached[child] = 1;
+            flip[child] = flip[parent] ^ (vote < 0);
+            push_links(child);
+        }
+
+        std::size_t n_oriented = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (component[i] == none || !reached[component[i]]) continue;
+            if (flip[component[i]]) normals_[i] = -normals_[i];
+            oriented_[i] = 1;
+            ++n_oriented;
+        }
+        Report(n_tiles > 1 ? "tiled orientation" : "orientation", start);
+        if (verbose_ && n_tiles > 1)
+            std::cout << "  " << n_tiles << " tiles, " << n_components << " components, " << votes.size()
+                      << " component links" << std::endl;
+        return n - n_oriented;
+    }
+
+    // Drop points whose normal could not be oriented (after OrientNormals)
+    void RemoveUnoriented()
+    {
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < points_.size(); ++i)
+        {
+            if (!oriented_[i]) continue;
+            points_[kept] = points_[i];
+            normals_[kept] = normals_[i];
+            ++kept;
+        }
+        points_.resize(kept);
+        normals_.resize(kept);
+        oriented_.assign(kept, 1);
+        offsets_.clear(); // neighbor indices are stale
+        neighbors_.clear();
+    }
+
+    // Print every stage's time as it finishes (default); timings() keeps them either way
+    void set_verbose(bool verbose) { verbose_ = verbose; }
+    // (stage, milliseconds) in the order the stages ran
+    const std::vector<std::pair<std::string, double>> &timings() const { return timings_; }
+
+    const std::vector<Point> &points() const { return points_; }
+    const std::vector<Vector> &normals() const { return normals_; }
+    std::vector<Vector> &normals() { return normals_; }
+    std::size_t neighbor_count(std::size_t i) const { return offsets_[i + 1] - offsets_[i]; }
+    const std::uint32_t *neighbors(std::size_t i) const { return neighbors_.data() + offsets_[i]; }
+
+private:
+    typedef CGAL::Search_traits_3<Kernel> Traits_base_t;
+    typedef typename CGAL::Pointer_property_map<Point>::const_type Point_map_t;
+    typedef CGAL::Search_traits_adapter<std::size_t, Point_map_t, Traits_base_t> Traits_t;
+    typedef CGAL::Orthogonal_k_neighbor_search<Traits_t> Knn_t;
+    typedef typename Knn_t::Tree Tree_t;
+    typedef typename Knn_t::Distance Distance_t;
+    typedef CGAL::Fuzzy_sphere<Traits_t> Sphere_t;
+
+    // kNN lists are not symmetric by themselves; the orientation graph needs both directions
+    void SymmetricAdjacency(std::vector<std::size_t> &adj_offsets, std::vector<std::uint32_t> &adjacency) const
+    {
+        const std::size_t n = points_.size();
+        adj_offsets.assign(n + 1, 0);
+        for (std::size_t i = 0; i < n; ++i)
+            for (std::size_t a = offsets_[i]; a < offsets_[i + 1]; ++a)
+            {
+                ++adj_offsets[i + 1];
+                ++adj_offsets[neighbors_[a] + 1];
+            }
+        for (std::size_t i = 0; i < n; ++i) adj_offsets[i + 1] += adj_offsets[i];
+        adjacency.resize(adj_offsets[n]);
+        std::vector<std::size_t> fill(adj_offsets.begin(), adj_offsets.end() - 1);
+        for (std::size_t i = 0; i < n; ++i)
+            for (std::size_t a = offsets_[i]; a < offsets_[i + 1]; ++a)
+            {
+                adjacency[fill[i]++] = neighbors_[a];
+                adjacency[fill[neighbors_[a]]++] = static_cast<std::uint32_t>(i);
+            }
+    }
+
+    // Median splits along the longest axis until every tile has at most tile_points points
+    void SplitTiles(std::size_t tile_points, std::vector<std::uint32_t> &order,
+                    std::vector<std::size_t> &tile_offsets) const
+    {
+        const std::size_t n = points_.size();
+        order.resize(n);
+        for (std::size_t i = 0; i < n; ++i) order[i] = static_cast<std::uint32_t>(i);
+        tile_offsets.assign(1, 0);
+        // depth first, lower half first: the tiles come out in order
+        std::vector<std::pair<std::size_t, std::size_t>> stack = {{0, n}};
+        while (!stack.empty())
+        {
+            const std::size_t begin = stack.back().first, end = stack.back().second;
+            stack.pop_back();
+            if (end - begin <= std::max<std::size_t>(tile_points, 1))
+            {
+                tile_offsets.push_back(end);
+                continue;
+            }
+            double lo[3] = {HUGE_VAL, HUGE_VAL, HUGE_VAL}, hi[3] = {-HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+            for (std::size_t k = begin; k < end; ++k)
+                for (int d = 0; d < 3; ++d)
+                {
+                    const double v = CGAL::to_double(points_[order[k]][d]);
+                    lo[d] = std::min(lo[d], v);
+                    hi[d] = std::max(hi[d], v);
+                }
+            int axis = 0;
+            for (int d = 1; d < 3; ++d)
+                if (hi[d] - lo[d] > hi[axis] - lo[axis]) axis = d;
+            const std::size_t mid = begin + (end - begin) / 2;
+            std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                             [&](std::uint32_t a, std::uint32_t b) { return points_[a][axis] < points_[b][axis]; });
+            stack.push_back({mid, end});
+            stack.push_back({begin, mid});
+        }
+    }
+
+    void Report(const char *stage, std::chrono::steady_clock::time_point start)
+    {
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        timings_.emplace_back(stage, ms);
+        if (verbose_) std::cout << stage << ": " << ms << " ms" << std::endl;
+    }
+
+    void EstimatePCA(std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const std::size_t m = neighbor_count(i) + 1;
+            normals_[i] = CGAL::NULL_VECTOR; // unless estimated below
+            if (m < 3) continue;
+            // centroid and covariance of the point and its neighbors
+            const Point &p = points_[i];
+            double c[3] = {CGAL::to_double(p.x()), CGAL::to_double(p.y()), CGAL::to_double(p.z())};
+            for (std::size_t a = offsets_[i]; a < offsets_[i + 1]; ++a)
+            {
+                const Point &q = points_[neighbors_[a]];
+                c[0] += CGAL::to_double(q.x());
+                c[1] += CGAL::to_double(q.y());
+                c[2] += CGAL::to_double(q.z());
+            }
+            for (double &v : c) v /= double(m);
+
+            std::array<double, 6> cov = {0, 0, 0, 0, 0, 0}; // xx xy xz yy yz zz
+            auto accumulate = [&](const Point &q)
+            {
+                const double d[3] = {CGAL::to_double(q.x()) - c[0], CGAL::to_double(q.y()) - c[1],
+                                     CGAL::to_double(q.z()) - c[2]};
+                cov[0] += d[0] * d[0];
+                cov[1] += d[0] * d[1];
+                cov[2] += d[0] * d[2];
+                cov[3] += d[1] * d[1];
+                cov[4] += d[1] * d[2];
+                cov[5] += d[2] * d[2];
+            };
+            accumulate(points_[i]);
+            for (std::size_t a = offsets_[i]; a < offsets_[i + 1]; ++a) accumulate(points_[neighbors_[a]]);
+
+            std::array<double, 3> eigenvalues;
+            std::array<double, 9> eigenvectors; // ascending eigenvalues
+            if (!CGAL::Default_diagonalize_traits<double, 3>::diagonalize_selfadjoint_covariance_matrix(
+                    cov, eigenvalues, eigenvectors))
+                continue;
+            normals_[i] = Vector(eigenvectors[0], eigenvectors[1], eigenvectors[2]);
+        }
+    }
+
+#ifdef CGAL_EIGEN3_ENABLED
+    void EstimateJet(std::size_t begin, std::size_t end)
+    {
+        typedef CGAL::Monge_via_jet_fitting<Kernel> Monge_fit_t;
+        std::vector<Point> local;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            local.clear();
+            local.push_back(points_[i]);
+            for (std::size_t a = offsets_[i]; a < offsets_[i + 1]; ++a) local.push_back(points_[neighbors_[a]]);
+            if (local.size() < 6) // a degree 2 jet needs 6 points
+            {
+                normals_[i] = CGAL::NULL_VECTOR;
+                continue;
+            }
+            // Monge degree 1: the normal only, no curvatures (as jet_estimate_normals)
+            Monge_fit_t monge_fit;
+            const typename Monge_fit_t::Monge_form monge_form = monge_fit(local.begin(), local.end(), 2, 1);
+            normals_[i] = monge_form.normal_direction();
+        }
+    }
+
+    void EstimateVCM()
+    {
+        // VCM integrates over offset balls, sized from the spacing of the shared neighborhoods
+        const double spacing = AverageSpacing();
+        typedef std::pair<Point, Vector> Point_with_normal_t;
+        std::vector<Point_with_normal_t> pwn(points_.size());
+        for (std::size_t i = 0; i < points_.size(); ++i) pwn[i].first = points_[i];
+        CGAL::vcm_estimate_normals(pwn, 4.0 * spacing, 2.0 * spacing,
+                                   CGAL::parameters::point_map(CGAL::First_of_pair_property_map<Point_with_normal_t>())
+                                       .normal_map(CGAL::Second_of_pair_property_map<Point_with_normal_t>()));
+        for (std::size_t i = 0; i < points_.size(); ++i) normals_[i] = pwn[i].second;
+    }
+#endif
+
+    std::vector<Point> points_;
+    std::vector<Vector> normals_;
+    std::vector<std::size_t> offsets_;      // CSR neighbor lists
+    std::vector<std::uint32_t> neighbors_;
+    std::vector<char> oriented_;
+    std::vector<std::pair<std::string, double>> timings_;
+    unsigned threads_ = 0;
+    bool verbose_ = true;
+};
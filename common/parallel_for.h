@@ -0,0 +1,34 @@
+#pragma once
+
+// Minimal parallel loop over std::thread, no scheduler dependency.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Run fn(begin, end) over [0, n) in chunks of grain items pulled by threads
+// (0 = hardware_concurrency) as they go idle
+inline void ParallelFor(std::size_t n, unsigned threads, const std::function<void(std::size_t, std::size_t)> &fn,
+                        std::size_t grain = 1024)
+{
+    grain = std::max<std::size_t>(grain, 1);
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, (n + grain - 1) / grain));
+    if (threads <= 1)
+    {
+        fn(0, n);
+        return;
+    }
+    std::atomic<std::size_t> next(0);
+    auto worker = [&]()
+    {
+        for (std::size_t begin = next.fetch_add(grain); begin < n; begin = next.fetch_add(grain))
+            fn(begin, std::min(begin + grain, n));
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) workers.emplace_back(worker);
+    for (auto &w : workers) w.join();
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+// Binary point-cloud cache.
+//
+// The first time an ASCII point file is loaded it is parsed with point_loader.h
+// and written next to it as <file>.pcache; later runs memory-map the cache and
+// read the values in place, so startup costs page faults instead of parsing.
+//
+// Layout (little endian, native float):
+//   PointCacheHeader (64 bytes)
+//   channel 0: count floats   (x)
+//   channel 1: count floats   (y)
+//   channel 2: count floats   (z)
+//   channel 3..: count floats each (e.g. nx ny nz, or any extra attribute)
+//
+// The header records size and mtime of the ASCII source, a cache that does not
+// match them is rebuilt.
+
+#include "mapped_file.h"
+#include "point_loader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+struct PointCacheHeader
+{
+    char magic[8];           // "PCACHE\0\0"
+    std::uint32_t version;   // 1
+    std::uint32_t channels;  // floats per point
+    std::uint64_t count;     // number of points
+    float bbox_min[3];
+    float bbox_max[3];
+    std::uint64_t source_size;
+    std::int64_t source_mtime;
+};
+static_assert(sizeof(PointCacheHeader) == 64, "PointCacheHeader must stay 64 bytes");
+
+class PointCache
+{
+public:
+    static constexpr std::uint32_t kVersion = 1;
+
+    // Load filename through its binary cache, creating or refreshing the cache as needed.
+    // A .pcache file (e.g. written by a batch tool) is mapped directly.
+    bool Load(const std::string &filename)
+    {
+        if (IsCacheName(filename))
+        {
+            if (!Map(filename)) return false;
+            std::cout << "Mapped " << size() << " points from " << filename << "\n";
+            return true;
+        }
+        const std::string cache_name = filename + ".pcache";
+        std::uint64_t src_size = 0;
+        std::int64_t src_mtime = 0;
+        const bool has_source = FileStamp(filename, src_size, src_mtime);
+
+        if (Map(cache_name) && (!has_source || (header_->source_size == src_size && header_->source_mtime == src_mtime)))
+        {
+            std::cout << "Mapped " << size() << " points from " << cache_name << "\n";
+            return true;
+        }
+
+        PointTable table;
+        if (!LoadPointTable(filename, table)) return false;
+        FromTable(table, src_size, src_mtime);
+        if (!Write(cache_name))
+            std::cerr << "Could not write point cache " << cache_name << "\n";
+        return true;
+    }
+
+    // Memory-map an existing cache file
+    bool Map(const std::string &cache_name)
+    {
+        Reset();
+        if (!file_.Open(cache_name) || file_.size() < sizeof(PointCacheHeader)) return false;
+        auto header = reinterpret_cast<const PointCacheHeader *>(file_.data());
+        const std::uint64_t expected = sizeof(PointCacheHeader) + header->count * header->channels * sizeof(float);
+        if (std::memcmp(header->magic, "PCACHE", 6) != 0 || header->version != kVersion || file_.size() != expected)
+        {
+            file_.Close();
+            return false;
+        }
+        header_ = header;
+        data_ = reinterpret_cast<const float *>(file_.data() + sizeof(PointCacheHeader));
+        return true;
+    }
+
+    // Take over a parsed table (row-major) as channel arrays
+    void FromTable(const PointTable &table, std::uint64_t src_size = 0, std::int64_t src_mtime = 0)
+    {
+        const std::size_t n = table.rows();
+        const std::size_t c = table.columns;
+        std::vector<float> values(n * c);
+        for (std::size_t i = 0; i < n; ++i)
+            for (std::size_t k = 0; k < c; ++k)
+                values[k * n + i] = table.values[i * c + k];
+        FromChannels(std::move(values), c, src_size, src_mtime);
+    }
+
+    // Take over channel-major values: channel k is values[k * n, (k + 1) * n), n = values.size() / channels
+    void FromChannels(std::vector<float> values, std::size_t channels, std::uint64_t src_size = 0,
+                      std::int64_t src_mtime = 0)
+    {
+        Reset();
+        const std::size_t c = channels;
+        const std::size_t n = c ? values.size() / c : 0;
+        owned_ = std::move(values);
+
+        std::memset(&owned_header_, 0, sizeof(owned_header_));
+        std::memcpy(owned_header_.magic, "PCACHE", 6);
+        owned_header_.version = kVersion;
+        owned_header_.channels = static_cast<std::uint32_t>(c);
+        owned_header_.count = n;
+        owned_header_.source_size = src_size;
+        owned_header_.source_mtime = src_mtime;
+        for (int k = 0; k < 3; ++k)
+        {
+            owned_header_.bbox_min[k] = std::numeric_limits<float>::max();
+            owned_header_.bbox_max[k] = std::numeric_limits<float>::lowest();
+        }
+        for (std::size_t k = 0; k < std::min<std::size_t>(c, 3); ++k)
+        {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                owned_header_.bbox_min[k] = std::min(owned_header_.bbox_min[k], owned_[k * n + i]);
+                owned_header_.bbox_max[k] = std::max(owned_header_.bbox_max[k], owned_[k * n + i]);
+            }
+        }
+        header_ = &owned_header_;
+        data_ = owned_.data();
+    }
+
+    bool Write(const std::string &cache_name) const
+    {
+        if (!header_) return false;
+        const std::string tmp_name = cache_name + ".tmp";
+        {
+            std::ofstream out(tmp_name, std::ios::binary);
+            if (!out) return false;
+            out.write(reinterpret_cast<const char *>(header_), sizeof(PointCacheHeader));
+            out.write(reinterpret_cast<const char *>(data_), header_->count * header_->channels * sizeof(float));
+            if (!out) return false;
+        }
+        return std::rename(tmp_name.c_str(), cache_name.c_str()) == 0; // readers never see a partial file
+    }
+
+    static bool IsCacheName(const std::string &filename)
+    {
+        const std::string suffix = ".pcache";
+        return filename.size() >= suffix.size() &&
+               filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    std::size_t size() const { return header_ ? header_->count : 0; }
+    std::size_t channels() const { return header_ ? header_->channels : 0; }
+    const float *channel(std::size_t k) const { return data_ + k * size(); }
+    const float *bbox_min() const { return header_->bbox_min; }
+    const float *bbox_max() const { return header_->bbox_max; }
+
+private:
+    void Reset()
+    {
+        file_.Close();
+        owned_.clear();
+        header_ = nullptr;
+        data_ = nullptr;
+    }
+
+    MappedFile file_;
+    std::vector<float> owned_;  // used when the points came from ASCII this run
+    PointCacheHeader owned_header_{};
+    const PointCacheHeader *header_ = nullptr;
+    const float *data_ = nullptr;
+};
@@ -0,0 +1,171 @@
+#pragma once
+
+// Fast loader for ASCII point clouds: one point per line, values separated by
+// commas and/or whitespace. Covers bunny.csv (x,y,z), bunny.xyz (x y z) and
+// bunny_with_normals.xyz (6 values per line). Lines starting with '#' and
+// empty lines are skipped, lines with fewer values than the first data line
+// are dropped, extra values are ignored.
+//
+// The file is memory-mapped and parsed in place with std::from_chars. Large
+// files are split into chunks at line boundaries and parsed by several
+// threads; each chunk writes straight into its slice of the pre-sized output.
+
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Flat row-major table of floats, `columns` values per point
+struct PointTable
+{
+    std::size_t columns = 0;
+    std::vector<float> values;
+
+    std::size_t rows() const { return columns ? values.size() / columns : 0; }
+};
+
+namespace point_loader_detail
+{
+inline bool IsDelimiter(char c) { return c == ',' || c == ' ' || c == '\t' || c == '\r'; }
+
+// Parse up to `columns` floats from [p, line_end) into out. Returns the number parsed.
+inline std::size_t ParseLine(const char *p, const char *line_end, float *out, std::size_t columns)
+{
+    std::size_t n = 0;
+    while (n < columns)
+    {
+        while (p < line_end && IsDelimiter(*p)) ++p;
+        if (p >= line_end) break;
+        auto [next, ec] = std::from_chars(p, line_end, out[n]);
+        if (ec != std::errc()) break;
+        p = next;
+        ++n;
+    }
+    return n;
+}
+
+inline const char *LineEnd(const char *p, const char *end)
+{
+    const void *nl = std::memchr(p, '\n', end - p);
+    return nl ? static_cast<const char *>(nl) : end;
+}
+
+inline bool IsDataLine(const char *p, const char *line_end)
+{
+    while (p < line_end && IsDelimiter(*p)) ++p;
+    return p < line_end && *p != '#';
+}
+
+// Parse every complete row in [begin, end) into out, returns the number of rows written
+inline std::size_t ParseChunk(const char *begin, const char *end, float *out, std::size_t columns)
+{
+    std::size_t rows = 0;
+    for (const char *p = begin; p < end;)
+    {
+        const char *line_end = LineEnd(p, end);
+        if (IsDataLine(p, line_end) && ParseLine(p, line_end, out + rows * columns, columns) == columns)
+            ++rows;
+        p = line_end + 1;
+    }
+    return rows;
+}
+} // namespace point_loader_detail
+
+// Parse an in-memory buffer. threads == 0 picks hardware_concurrency for large inputs.
+inline bool ParsePointTable(const char *data, std::size_t size, PointTable &table, unsigned threads = 0)
+{
+    using namespace point_loader_detail;
+    const char *end = data + size;
+
+    // number of columns from the first data line
+    table.columns = 0;
+    table.values.clear();
+    for (const char *p = data; p < end;)
+    {
+        const char *line_end = LineEnd(p, end);
+        if (IsDataLine(p, line_end))
+        {
+            float scratch[16];
+            table.columns = ParseLine(p, line_end, scratch, 16);
+            break;
+        }
+        p = line_end + 1;
+    }
+    if (table.columns == 0) return false;
+
+    if (threads == 0)
+        threads = size < (8u << 20) ? 1u : std::max(1u, std::thread::hardware_concurrency());
+
+    // chunk boundaries moved forward to the start of the next line
+    std::vector<const char *> bounds(threads + 1, end);
+    bounds[0] = data;
+    for (unsigned t = 1; t < threads; ++t)
+    {
+        const char *p = std::max(bounds[t - 1], data + size * t / threads);
+        if (p > data && p < end && p[-1] != '\n')
+        {
+            p = LineEnd(p, end);
+            if (p < end) ++p;
+        }
+        bounds[t] = p;
+    }
+
+    // every row in a chunk ends with at most one '\n', so newlines + 1 bounds the row count
+    std::vector<std::size_t> offsets(threads + 1, 0);
+    for (unsigned t = 0; t < threads; ++t)
+        offsets[t + 1] = offsets[t] + std::count(bounds[t], bounds[t + 1], '\n') + 1;
+    table.values.resize(offsets[threads] * table.columns);
+
+    std::vector<std::size_t> rows(threads, 0);
+    auto parse = [&](unsigned t)
+    {
+        rows[t] = ParseChunk(bounds[t], bounds[t + 1], table.values.data() + offsets[t] * table.columns, table.columns);
+    };
+    if (threads == 1)
+        parse(0);
+    else
+    {
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) workers.emplace_back(parse, t);
+        for (auto &w : workers) w.join();
+    }
+
+    // close the gaps between chunk slices
+    std::size_t filled = 0;
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        const float *src = table.values.data() + offsets[t] * table.columns;
+        float *dst = table.values.data() + filled * table.columns;
+        if (dst != src) std::memmove(dst, src, rows[t] * table.columns * sizeof(float));
+        filled += rows[t];
+    }
+    table.values.resize(filled * table.columns);
+    return filled > 0;
+}
+
+inline bool LoadPointTable(const std::string &filename, PointTable &table, unsigned threads = 0)
+{
+    const auto start = std::chrono::steady_clock::now();
+    MappedFile file(filename);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open " << filename << "\n";
+        return false;
+    }
+    if (!ParsePointTable(file.data(), file.size(), table, threads))
+    {
+        std::cerr << "No points found in " << filename << "\n";
+        return false;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Loaded " << table.rows() << " points (" << table.columns << " values each) from "
+              << filename << " in " << seconds * 1000.0 << " ms, "
+              << (seconds > 0.0 ? file.size() / (1024.0 * 1024.0) / seconds : 0.0) << " MB/s\n";
+    return true;
+}
@@ -0,0 +1,266 @@
+#pragma once
+
+// Level-of-detail octree for large point clouds.
+//
+// Built over points normalized to the unit cube [-0.5, 0.5]^3 (NormalizePoints
+// in the viewers). Points are sorted in Morton order, then every node keeps an
+// evenly strided subsample of its points (at most node_capacity) and hands the
+// rest down to its children. The resulting permutation (order()) lays each
+// node's subsample out as one contiguous range, so upload the points in that
+// order and draw a selection with glMultiDrawArrays over the returned ranges.
+// Drawing a node together with all its ancestors gives a uniformly denser
+// sample of its region.
+//
+// Select() walks the tree largest-projected-node first and stops at the point
+// budget; nodes outside the view frustum or smaller than min_pixels on screen
+// are not refined. LodBudget grows the budget while the camera is still, which
+// refines the picture progressively over a few frames.
+
+#include "frustum.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <vector>
+
+class PointOctree
+{
+public:
+    struct Node
+    {
+        float center[3];
+        float half;                  // half edge of the node cube
+        std::uint32_t first = 0;     // subsample range in order()
+        std::uint32_t count = 0;
+        std::int32_t children[8];    // -1 if absent
+    };
+
+    // Ranges of order() to draw, parallel arrays as glMultiDrawArrays wants them
+    struct Selection
+    {
+        std::vector<int> first;
+        std::vector<int> count;
+        std::size_t points = 0;
+        bool complete = false; // nothing left to refine within the budget
+    };
+
+    // xyz holds n interleaved points
+    void Build(const float *xyz, std::size_t n, std::size_t node_capacity = 4096, int max_depth = 16)
+    {
+        nodes_.clear();
+        order_.resize(n);
+        capacity_ = std::max<std::size_t>(node_capacity, 1);
+        max_depth_ = std::min(max_depth, kBits);
+        if (n == 0) return;
+
+        std::vector<std::uint64_t> codes(n);
+        for (std::size_t i = 0; i < n; ++i)
+            codes[i] = MortonCode(xyz + 3 * i);
+        std::iota(order_.begin(), order_.end(), 0u);
+        std::sort(order_.begin(), order_.end(),
+                  [&](std::uint32_t a, std::uint32_t b) { return codes[a] < codes[b]; });
+
+        std::vector<std::uint64_t> sorted_codes(n);
+        for (std::size_t i = 0; i < n; ++i) sorted_codes[i] = codes[order_[i]];
+        codes.clear();
+        codes.shrink_to_fit();
+
+        scratch_.resize(n);
+        code_scratch_.resize(n);
+        const float root_center[3] = {0.0f, 0.0f, 0.0f};
+        BuildNode(sorted_codes, 0, n, 0, root_center, 0.5f);
+        scratch_.clear();
+        scratch_.shrink_to_fit();
+        code_scratch_.clear();
+        code_scratch_.shrink_to_fit();
+    }
+
+    // mvp: column-major model-view-projection, focal_px: projection[1][1] * viewport_height / 2
+    Selection Select(const float mvp[16], float focal_px, std::size_t budget, float min_pixels = 10.0f) const
+    {
+        Selection sel;
+        if (nodes_.empty()) return sel;
+
+        const Frustum frustum(mvp);
+
+        typedef std::pair<float, std::int32_t> Entry_t; // projected size, node
+        std::priority_queue<Entry_t> queue;
+        queue.push({std::numeric_limits<float>::max(), 0});
+        bool truncated = false;
+        while (!queue.empty())
+        {
+            const Node &node = nodes_[queue.top().second];
+            queue.pop();
+            if (sel.points > 0 && sel.points + node.count > budget)
+            {
+                truncated = true;
+                break;
+            }
+            sel.first.push_back(static_cast<int>(node.first));
+            sel.count.push_back(static_cast<int>(node.count));
+            sel.points += node.count;
+
+            for (std::int32_t c : node.children)
+            {
+                if (c < 0) continue;
+                const Node &child = nodes_[c];
+                const float radius = child.half * 1.7320508f;
+                if (!frustum.SphereVisible(child.center, radius)) continue;
+                const float size = ProjectedSize(mvp, focal_px, child.center, radius);
+                if (size < min_pixels) continue;
+                queue.push({size, c});
+            }
+        }
+        sel.complete = !truncated;
+        return sel;
+    }
+
+    // Copy per-point values (dims floats each) into octree order
+    std::vector<float> Reorder(const float *values, int dims) const
+    {
+        std::vector<float> out(order_.size() * dims);
+        for (std::size_t k = 0; k < order_.size(); ++k)
+            std::memcpy(&out[k * dims], values + std::size_t(order_[k]) * dims, dims * sizeof(float));
+        return out;
+    }
+
+    const std::vector<std::uint32_t> &order() const { return order_; }
+    const std::vector<Node> &nodes() const { return nodes_; }
+    std::size_t size() const { return order_.size(); }
+
+private:
+    static constexpr int kBits = 21; // per axis, 63-bit codes
+
+    static std::uint64_t SpreadBits(std::uint64_t v)
+    {
+        v &= 0x1fffff;
+        v = (v | v << 32) & 0x1f00000000ffffull;
+        v = (v | v << 16) & 0x1f0000ff0000ffull;
+        v = (v | v << 8) & 0x100f00f00f00f00full;
+        v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+        v = (v | v << 2) & 0x1249249249249249ull;
+        return v;
+    }
+
+    static std::uint64_t MortonCode(const float *p)
+    {
+        std::uint64_t q[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            const float t = std::min(std::max(p[k] + 0.5f, 0.0f), 1.0f); // unit cube -> [0,1]
+            q[k] = std::min<std::uint64_t>(static_cast<std::uint64_t>(t * (1 << kBits)), (1 << kBits) - 1);
+        }
+        return SpreadBits(q[0]) << 2 | SpreadBits(q[1]) << 1 | SpreadBits(q[2]);
+    }
+
+    // Points [begin, end) of order_ are this node's, Morton sorted (codes alongside).
+    // Moves the strided subsample to the front and recurses on the rest per octant.
+    std::int32_t BuildNode(std::vector<std::uint64_t> &codes, std::size_t begin, std::size_t end, int depth,
+                           const float center[3], float half)
+    {
+        const std::int32_t id = static_cast<std::int32_t>(nodes_.size());
+        nodes_.emplace_back();
+        Node node;
+        std::copy(center, center + 3, node.center);
+        node.half = half;
+        std::fill(node.children, node.children + 8, -1);
+        node.first = static_cast<std::uint32_t>(begin);
+
+        const std::size_t n = end - begin;
+        if (n <= capacity_ || depth >= max_depth_)
+        {
+            node.count = static_cast<std::uint32_t>(n);
+            nodes_[id] = node;
+            return id;
+        }
+
+        // stable split: every stride-th point to the front, the rest keeps Morton order
+        const std::size_t stride = (n + capacity_ - 1) / capacity_;
+        std::size_t n_samples = 0, n_rest = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (i % stride == 0)
+            {
+                order_[begin + n_samples] = order_[begin + i];
+                codes[begin + n_samples] = codes[begin + i];
+                ++n_samples;
+            }
+            else
+            {
+                scratch_[n_rest] = order_[begin + i];
+                code_scratch_[n_rest] = codes[begin + i];
+                ++n_rest;
+            }
+        }
+        std::copy(scratch_.begin(), scratch_.begin() + n_rest, order_.begin() + begin + n_samples);
+        std::copy(code_scratch_.begin(), code_scratch_.begin() + n_rest, codes.begin() + begin + n_samples);
+        node.count = static_cast<std::uint32_t>(n_samples);
+        nodes_[id] = node;
+
+        // children are contiguous runs of the octant digit at this depth
+        const int shift = 3 * (kBits - 1 - depth);
+        std::size_t run = begin + n_samples;
+        while (run < end)
+        {
+            const int octant = static_cast<int>((codes[run] >> shift) & 7);
+            std::size_t run_end = run;
+            while (run_end < end && static_cast<int>((codes[run_end] >> shift) & 7) == octant) ++run_end;
+
+            const float child_half = half * 0.5f;
+            const float child_center[3] = {center[0] + ((octant & 4) ? child_half : -child_half),
+                                           center[1] + ((octant & 2) ? child_half : -child_half),
+                                           center[2] + ((octant & 1) ? child_half : -child_half)};
+            const std::int32_t child = BuildNode(codes, run, run_end, depth + 1, child_center, child_half);
+            nodes_[id].children[octant] = child;
+            run = run_end;
+        }
+        return id;
+    }
+
+    // Approximate diameter in pixels of a sphere, unbounded when the camera is inside it
+    static float ProjectedSize(const float m[16], float focal_px, const float c[3], float radius)
+    {
+        const float w = m[3] * c[0] + m[7] * c[1] + m[11] * c[2] + m[15];
+        if (w <= radius) return std::numeric_limits<float>::max();
+        return 2.0f * radius * focal_px / w;
+    }
+
+    std::vector<Node> nodes_;
+    std::vector<std::uint32_t> order_;
+    std::vector<std::uint32_t> scratch_;
+    std::vector<std::uint64_t> code_scratch_;
+    std::size_t capacity_ = 4096;
+    int max_depth_ = 16;
+};
+
+// Point budget that starts low while the camera moves and doubles every
+// still frame up to max_points (progressive refinement)
+class LodBudget
+{
+public:
+    explicit LodBudget(std::size_t moving_points = 1000000, std::size_t max_points = 8000000)
+        : moving_(moving_points), max_(max_points), current_(moving_points) {}
+
+    std::size_t Update(const float mvp[16])
+    {
+        if (std::memcmp(mvp, last_mvp_, sizeof(last_mvp_)) != 0)
+        {
+            std::memcpy(last_mvp_, mvp, sizeof(last_mvp_));
+            current_ = moving_;
+        }
+        else
+            current_ = std::min(current_ * 2, max_);
+        return current_;
+    }
+
+    std::size_t current() const { return current_; }
+
+private:
+    std::size_t moving_, max_, current_;
+    float last_mvp_[16] = {};
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+// Buffered ASCII point writer.
+//
+// Values are formatted with std::to_chars (shortest form that reads back to the
+// same float, independent of locale and stream state) into one large buffer
+// that is flushed with fwrite, one row of space separated values per point.
+// The file is written as <file>.tmp and renamed on Close(), like the caches.
+
+#include <charconv>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class PointWriter
+{
+public:
+    explicit PointWriter(std::size_t buffer_bytes = 1 << 20) : buffer_(buffer_bytes) {}
+    ~PointWriter() { Close(); }
+
+    PointWriter(const PointWriter &) = delete;
+    PointWriter &operator=(const PointWriter &) = delete;
+
+    bool Open(const std::string &filename)
+    {
+        Close();
+        filename_ = filename;
+        file_ = std::fopen((filename_ + ".tmp").c_str(), "wb");
+        used_ = 0;
+        failed_ = file_ == nullptr;
+        return !failed_;
+    }
+
+    // One point: count values separated by spaces
+    void Row(const float *values, std::size_t count)
+    {
+        // a float takes at most 15 characters plus the separator
+        if (buffer_.size() - used_ < 16 * count + 1) Flush();
+        char *out = buffer_.data() + used_;
+        char *const end = buffer_.data() + buffer_.size();
+        for (std::size_t k = 0; k < count; ++k)
+        {
+            if (k > 0) *out++ = ' ';
+            out = std::to_chars(out, end, values[k]).ptr;
+        }
+        *out++ = '\n';
+        used_ = out - buffer_.data();
+    }
+
+    // Flush, close and move the file in place; false if anything failed
+    bool Close()
+    {
+        if (!file_) return false;
+        Flush();
+        failed_ |= std::fclose(file_) != 0;
+        file_ = nullptr;
+        const std::string tmp_name = filename_ + ".tmp";
+        if (failed_)
+        {
+            std::remove(tmp_name.c_str());
+            return false;
+        }
+        return std::rename(tmp_name.c_str(), filename_.c_str()) == 0;
+    }
+
+private:
+    void Flush()
+    {
+        if (file_ && used_ > 0) failed_ |= std::fwrite(buffer_.data(), 1, used_, file_) != used_;
+        used_ = 0;
+    }
+
+    std::vector<char> buffer_;
+    std::size_t used_ = 0;
+    std::string filename_;
+    std::FILE *file_ = nullptr;
+    bool failed_ = false;
+};
@@ -8,6 +8,8 @@
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_opengl3.h"
 
+#include "background_job.h"
+
 #include <vector>
 #include <iostream>
 #include <cstdlib>
@@ -19,12 +21,11 @@ typedef Kernel_t::Point_2 Point;
 typedef Kernel_t::Weighted_point_2 WeightedPoint;
 
 // global variables!
-static Delaunay_t delaunay;
-static Regular_t regular;
 static std::vector<Point> points;
 static std::vector<WeightedPoint> weighted_points;
 static int window_width = 1000;
 static int window_height = 500;
+static bool recompute = true;
 
 Point ScreenToWorld(double xpos, double ypos, double x_offset = 0.0)
 {
@@ -33,15 +34,42 @@ Point ScreenToWorld(double xpos, double ypos, double x_offset = 0.0)
     return Point(x, y);
 }
 
-void Recompute()
+// Edges (pairs of endpoints) of both triangulations, extracted on the worker thread
+struct TriangulationLines
 {
-    delaunay.clear();
-    regular.clear();
-    if (!points.empty())
+    std::vector<Point> delaunay;
+    std::vector<Point> regular;
+};
+
+TriangulationLines BuildTriangulations(const std::vector<WeightedPoint> &wpoints, const JobToken &token)
+{
+    TriangulationLines lines;
+    if (wpoints.empty()) return lines;
+
+    Delaunay_t delaunay;
+    for (auto &wp : wpoints) delaunay.insert(wp.point());
+    for (auto e = delaunay.finite_edges_begin(); e != delaunay.finite_edges_end(); ++e)
     {
-        delaunay.insert(points.begin(), points.end());
-        regular.insert(weighted_points.begin(), weighted_points.end());
+        auto seg = delaunay.segment(*e);
+        lines.delaunay.push_back(seg.source());
+        lines.delaunay.push_back(seg.target());
     }
+    if (token.Cancelled()) return lines;
+
+    Regular_t regular;
+    regular.insert(wpoints.begin(), wpoints.end());
+    for (auto e = regular.finite_edges_begin(); e != regular.finite_edges_end(); ++e)
+    {
+        auto seg = regular.segment(*e);
+        lines.regular.push_back(Point(seg.source().x(), seg.source().y()));
+        lines.regular.push_back(Point(seg.target().x(), seg.target().y()));
+    }
+    return lines;
+}
+
+void Recompute()
+{
+    recompute = true;
 }
 
 // callback funtion for mouse clicks
@@ -66,46 +94,14 @@ void MouseBtnCB(GLFWwindow *window, int button, int action, int mods)
     }
 }
 
-void DrawTriangulation(const Delaunay_t &dt, double x_offset)
-{
-    glPushMatrix();
-    glTranslated(x_offset, 0, 0);
-    glColor3f(1.0f, 1.0f, 1.0f);
-    // glColor3f(0.2f, 0.6f, 1.0f);
-    glBegin(GL_LINES);
-    for (auto f = dt.finite_faces_begin(); f != dt.finite_faces_end(); ++f)
-    {
-        auto tri = dt.triangle(f);
-        for (int i = 0; i < 3; ++i)
-        {
-            auto a = tri.vertex(i);
-            auto b = tri.vertex((i + 1) % 3);
-            glVertex2f(a.x(), a.y());
-            glVertex2f(b.x(), b.y());
-        }
-    }
-    glEnd();
-    glPopMatrix();
-}
-
-void DrawTriangulation(const Regular_t &rt, double x_offset)
+void DrawTriangulation(const std::vector<Point> &lines, double x_offset)
 {
     glPushMatrix();
     glTranslated(x_offset, 0, 0);
     glColor3f(1.0f, 1.0f, 1.0f);
-    // glColor3f(0.3f, 0.9f, 0.3f);
     glBegin(GL_LINES);
-    for (auto f = rt.finite_faces_begin(); f != rt.finite_faces_end(); ++f)
-    {
-        auto tri = rt.triangle(f);
-        for (int i = 0; i < 3; ++i)
-        {
-            auto a = tri.vertex(i);
-            auto b = tri.vertex((i + 1) % 3);
-            glVertex2f(a.x(), a.y());
-            glVertex2f(b.x(), b.y());
-        }
-    }
+    for (auto &p : lines)
+        glVertex2f(p.x(), p.y());
     glEnd();
     glPopMatrix();
 }
@@ -171,12 +167,23 @@ int main()
         WeightedPoint(points[2], 0.3)};
     Recompute();
 
+    // both triangulations are built on a worker thread and swapped into lines when done
+    BackgroundJob<std::vector<WeightedPoint>, TriangulationLines> triangulation_job(BuildTriangulations);
+    TriangulationLines lines;
+
     bool show_points = true;
 
     while (!glfwWindowShouldClose(window))
     {
         glfwPollEvents();
 
+        if (recompute)
+        {
+            triangulation_job.Submit(weighted_points);
+            recompute = false;
+        }
+        triangulation_job.Poll(lines);
+
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -195,6 +202,8 @@ int main()
                 weighted_points.push_back(WeightedPoint(p, (rand() % 100) / 300.0));
             Recompute();
         }
+        if (triangulation_job.Busy())
+            ImGui::Text("computing...");
 
         glViewport(0, 0, window_width, window_height);
         // glClearColor(0.08f, 0.08f, 0.1f, 1.0f);
@@ -208,11 +217,11 @@ int main()
         glLoadIdentity();
 
         // render DT in left panel
-        DrawTriangulation(delaunay, 0.0);
+        DrawTriangulation(lines.delaunay, 0.0);
         DrawPoints(0.0);
 
         // render RT in right panel
-        DrawTriangulation(regular, 1.0);
+        DrawTriangulation(lines.regular, 1.0);
         DrawPoints(1.0);
 
         // render weights text label in right panel
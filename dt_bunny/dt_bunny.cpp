@@ -1,44 +1,52 @@
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <CGAL/Delaunay_triangulation_3.h>
+#include <CGAL/Triangulation_data_structure_3.h>
+#include <CGAL/Triangulation_vertex_base_with_info_3.h>
 
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <vector>
 #include <string>
+#include <cstring>
 #include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "imgui.h"
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_opengl3.h"
 
+#include "background_job.h"
+#include "gl_buffers.h"
+#include "lod_points.h"
+#include "point_cache.h"
+
 typedef CGAL::Exact_predicates_inexact_constructions_kernel Kernel_t;
-typedef CGAL::Delaunay_triangulation_3<Kernel_t> Delaunay_t;
+typedef CGAL::Triangulation_vertex_base_with_info_3<unsigned int, Kernel_t> Vb_t; // info = index into points
+typedef CGAL::Delaunay_triangulation_cell_base_3<Kernel_t> Cb_t;
+// With TBB the TDS is concurrency-safe; insertion only runs in parallel
+// when a lock data structure is attached (see BuildDelaunayEdges)
+#ifdef CGAL_LINKED_WITH_TBB
+typedef CGAL::Triangulation_data_structure_3<Vb_t, Cb_t, CGAL::Parallel_tag> Tds_t;
+#else
+typedef CGAL::Triangulation_data_structure_3<Vb_t, Cb_t, CGAL::Sequential_tag> Tds_t;
+#endif
+typedef CGAL::Delaunay_triangulation_3<Kernel_t, Tds_t> Delaunay_t;
 typedef Kernel_t::Point_3 Point3;
 
 struct Point{float x, y, z;};
 
+// Load through the binary point cache (<file>.pcache), written on first load
 std::vector<Point> LoadCSV(const std::string &filename)
 {
     std::vector<Point> pts;
-    std::ifstream file(filename);
-    if (!file.is_open())
-    {
-        std::cerr << "Failed to open " << filename << "\n";
-        return pts;
-    }
-    std::string line;
-    while (std::getline(file, line))
-    {
-        if (line.empty()) continue;
-        std::stringstream ss(line);
-        std::string sx, sy, sz;
-        std::getline(ss, sx, ',');
-        std::getline(ss, sy, ',');
-        std::getline(ss, sz, ',');
-        pts.push_back({std::stof(sx), std::stof(sy), std::stof(sz)});
-    }
-    std::cout << "Loaded " << pts.size() << " points\n";
+    PointCache cache;
+    if (!cache.Load(filename) || cache.channels() < 3) return pts;
+
+    const float *x = cache.channel(0), *y = cache.channel(1), *z = cache.channel(2);
+    pts.reserve(cache.size());
+    for (std::size_t i = 0; i < cache.size(); ++i)
+        pts.push_back({x[i], y[i], z[i]});
     return pts;
 }
 
@@ -71,55 +79,108 @@ void NormalizePoints(std::vector<Point> &pts)
 
 // global variables for edge cutoffs
 float max_edge_length = 0.2f;
+bool parallel_build = false; // --parallel
 bool show_delaunay = false;
 bool recompute_edges = false;
 
-// Build Delaunay and return edges as line segments
-std::vector<Point> BuildDelaunayEdges(const std::vector<Point> &pts, float max_length = -1.0f)
+// All finite Delaunay edges sorted by squared length, so the edges passing a
+// length cutoff are always a prefix of the index list
+struct DelaunayEdgeCache
 {
-    if (pts.empty()) return {};
+    std::vector<float> sq_lengths;     // ascending
+    std::vector<std::uint32_t> edges;  // index pairs into points, same order
+};
 
-    std::vector<Point> lines;
+// Build Delaunay once and cache its edges sorted by length
+DelaunayEdgeCache BuildDelaunayEdges(const std::vector<Point> &pts, bool parallel = false)
+{
+    DelaunayEdgeCache cache;
+    if (pts.empty()) return cache;
 
-    std::vector<Point3> cgal_points;
-    for (auto &p : pts) cgal_points.emplace_back(p.x, p.y, p.z);
+    std::vector<std::pair<Point3, unsigned int>> cgal_points;
+    cgal_points.reserve(pts.size());
+    for (unsigned int i = 0; i < pts.size(); ++i)
+        cgal_points.emplace_back(Point3(pts[i].x, pts[i].y, pts[i].z), i);
 
     Delaunay_t T;
+#ifdef CGAL_LINKED_WITH_TBB
+    // lock grid over the unit cube produced by NormalizePoints
+    Delaunay_t::Lock_data_structure lock_grid(CGAL::Bbox_3(-0.5, -0.5, -0.5, 0.5, 0.5, 0.5), 50);
+    if (parallel) T.set_lock_data_structure(&lock_grid);
+#endif
     T.insert(cgal_points.begin(), cgal_points.end());
+#ifdef CGAL_LINKED_WITH_TBB
+    T.set_lock_data_structure(nullptr);
+#endif
     std::cout << "vertices: " << T.number_of_vertices() << "\n";
     std::cout << "edges: " << T.number_of_finite_edges() << "\n";
 
+    const std::size_t n_edges = T.number_of_finite_edges();
+    std::vector<float> sq_lengths;
+    std::vector<std::uint32_t> edges;
+    sq_lengths.reserve(n_edges);
+    edges.reserve(n_edges * 2);
     for (auto eit = T.finite_edges_begin(); eit != T.finite_edges_end(); ++eit)
     {
-        auto seg = T.segment(*eit);
-        double len = std::sqrt(CGAL::squared_distance(seg.source(), seg.target()));
-        if (max_length > 0.0f && len > max_length) continue;
-        lines.push_back({(float)seg.source().x(), (float)seg.source().y(), (float)seg.source().z()});
-        lines.push_back({(float)seg.target().x(), (float)seg.target().y(), (float)seg.target().z()});
+        const std::uint32_t a = eit->first->vertex(eit->second)->info();
+        const std::uint32_t b = eit->first->vertex(eit->third)->info();
+        const float dx = pts[a].x - pts[b].x;
+        const float dy = pts[a].y - pts[b].y;
+        const float dz = pts[a].z - pts[b].z;
+        sq_lengths.push_back(dx * dx + dy * dy + dz * dz);
+        edges.push_back(a);
+        edges.push_back(b);
     }
-    std::cout << "generated " << lines.size() / 2 << " edges.\n";
-    return lines;
+
+    // sort edges by length through a permutation
+    std::vector<std::uint32_t> order(sq_lengths.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(),
+              [&](std::uint32_t i, std::uint32_t j) { return sq_lengths[i] < sq_lengths[j]; });
+
+    cache.sq_lengths.reserve(order.size());
+    cache.edges.reserve(order.size() * 2);
+    for (std::uint32_t e : order)
+    {
+        cache.sq_lengths.push_back(sq_lengths[e]);
+        cache.edges.push_back(edges[2 * e]);
+        cache.edges.push_back(edges[2 * e + 1]);
+    }
+    return cache;
 }
 
-void DrawPoints(const std::vector<Point> &pts)
+// Number of cached edges not longer than max_length (all edges if max_length <= 0)
+std::size_t CountEdgesUpTo(const DelaunayEdgeCache &cache, float max_length)
+{
+    if (max_length <= 0.0f) return cache.sq_lengths.size();
+    return std::upper_bound(cache.sq_lengths.begin(), cache.sq_lengths.end(), max_length * max_length)
+           - cache.sq_lengths.begin();
+}
+
+// points go through the LOD octree, only the nodes selected for the view are drawn
+void DrawPoints(LodPoints &lod_points)
 {
     glPointSize(2.0f);
-    glBegin(GL_POINTS);
     glColor3f(1.0f, 0.8f, 0.1f);
-    for (auto &p : pts) glVertex3f(p.x, p.y, p.z);
-    glEnd();
+    lod_points.Draw();
 }
 
-void DrawLines(const std::vector<Point> &lines)
+// draw the first n_edges index pairs of the uploaded edges
+void DrawLines(const GeometryBuffer &points_gpu, std::size_t n_edges)
 {
-    glBegin(GL_LINES);
     glColor3f(0.1f, 0.9f, 1.0f);
-    for (auto &p : lines) glVertex3f(p.x, p.y, p.z);
-    glEnd();
+    points_gpu.DrawElements(GL_LINES, 2 * n_edges);
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+    for (int i = 1; i < argc; ++i)
+        if (std::strcmp(argv[i], "--parallel") == 0) parallel_build = true;
+#ifndef CGAL_LINKED_WITH_TBB
+    if (parallel_build) std::cerr << "built without TBB, --parallel ignored\n";
+    parallel_build = false;
+#endif
+
     if (!glfwInit())
         return -1;
 
@@ -130,6 +191,7 @@ int main()
         return -1;
     }
     glfwMakeContextCurrent(window);
+    gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
     glfwSwapInterval(1);
 
     // Setup ImGui
@@ -143,8 +205,19 @@ int main()
     std::vector<Point> points = LoadCSV("../bunny.csv");
     NormalizePoints(points);
 
-    // perform triangulation
-    std::vector<Point> delaunay_edges = BuildDelaunayEdges(points, 0.2f);
+    // upload once; the sorted edge list goes into the index buffer when it arrives
+    static_assert(sizeof(Point) == 3 * sizeof(float), "Point must be tightly packed xyz");
+    GeometryBuffer points_gpu;
+    points_gpu.SetVertices(reinterpret_cast<const float *>(points.data()), points.size());
+    LodPoints lod_points;
+    lod_points.Build(reinterpret_cast<const float *>(points.data()), points.size());
+
+    // perform triangulation off the render thread, the slider only moves a cutoff in the cached edges
+    BackgroundJob<bool, DelaunayEdgeCache> triangulation_job(
+        [&](const bool &parallel, const JobToken &) { return BuildDelaunayEdges(points, parallel); });
+    triangulation_job.Submit(parallel_build);
+    DelaunayEdgeCache delaunay_edges; // front buffer, swapped in when the worker is done
+    std::size_t n_visible_edges = 0;
 
     bool show_delaunay = false;
 
@@ -169,9 +242,16 @@ int main()
         glLoadIdentity();
         glTranslatef(0.0f, 0.0f, -2.0f);
 
-        DrawPoints(points);
+        // pick up the triangulation once the background build has finished
+        if (triangulation_job.Poll(delaunay_edges))
+        {
+            n_visible_edges = CountEdgesUpTo(delaunay_edges, max_edge_length);
+            points_gpu.SetIndices(delaunay_edges.edges);
+        }
+
+        DrawPoints(lod_points);
         if (show_delaunay)
-            DrawLines(delaunay_edges);
+            DrawLines(points_gpu, n_visible_edges);
 
         // ImGui UI
         ImGui_ImplOpenGL3_NewFrame();
@@ -185,12 +265,18 @@ int main()
 
         if (recompute_edges)
         {
-            delaunay_edges = BuildDelaunayEdges(points, max_edge_length);
+            n_visible_edges = CountEdgesUpTo(delaunay_edges, max_edge_length);
             recompute_edges = false;
         }
 
-        ImGui::Text("#points: %zu", points.size());
-        ImGui::Text("#edges: %zu", delaunay_edges.size() / 2);
+        ImGui::Text("#points: %zu (drawn %zu)", points.size(), lod_points.drawn());
+        ImGui::Text("#edges: %zu", n_visible_edges);
+#ifdef CGAL_LINKED_WITH_TBB
+        if (ImGui::Checkbox("parallel build", &parallel_build))
+            triangulation_job.Submit(parallel_build);
+#endif
+        if (triangulation_job.Busy())
+            ImGui::Text("computing...");
 
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -198,6 +284,8 @@ int main()
         glfwSwapBuffers(window);
     }
 
+    points_gpu.Release();
+    lod_points.Release();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
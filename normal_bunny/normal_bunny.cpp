@@ -1,10 +1,6 @@
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
-#include <CGAL/compute_average_spacing.h>
-#include <CGAL/pca_estimate_normals.h>
-#include <CGAL/mst_orient_normals.h>
-#include <CGAL/property_map.h>
-#include <CGAL/IO/read_points.h>
 
+#include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -12,15 +8,26 @@
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_opengl3.h"
 
+#include "gl_buffers.h"
+#include "lod_points.h"
+#include "point_cache.h"
+#include "normals_engine.h"
+#include "point_writer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <utility>
-#include <list>
-#include <fstream>
 
 // Types
 typedef CGAL::Exact_predicates_inexact_constructions_kernel Kernel_t;
 typedef Kernel_t::Point_3 Point;
 typedef Kernel_t::Vector_3 Vector;
-typedef std::pair<Point, Vector> PointVectorPair; // Point with normal vector stored in a std::pair.
+typedef NormalsEngine<Kernel_t> NormalsEngine_t;
 
 std::vector<Point> NormalizePoints(std::vector<Point> &pts)
 {
@@ -58,32 +65,169 @@ std::vector<Point> NormalizePoints(std::vector<Point> &pts)
   return norm_pts;
 }
 
-void RenderPointsWithNormals(const std::vector<Point> &points, const std::vector<Vector> &normals, float normal_scale = 0.05f)
+// Upload normal segments (p, p + n * normal_scale), fallback when instancing is unavailable
+void UploadNormalSegments(const std::vector<Point> &points, const std::vector<Vector> &normals,
+                          GeometryBuffer &normals_gpu, float normal_scale)
 {
-  // Draw points
-  glPointSize(4.0f);
-  glBegin(GL_POINTS);
-  glColor3f(1.0f, 1.0f, 1.0f);
-  for (const auto &p : points)
-    glVertex3f(p.x(), p.y(), p.z());
-  glEnd();
-
-  // Draw normals as lines
-  glBegin(GL_LINES);
-  glColor3f(1.0f, 0.2f, 0.2f);
+  std::vector<float> segments;
+  segments.reserve(6 * points.size());
   for (size_t i = 0; i < points.size(); ++i)
   {
     const Point &p = points[i];
     const Vector &n = normals[i];
 
-    glVertex3f(p.x(), p.y(), p.z());
-    glVertex3f(p.x() + n.x() * normal_scale,
-               p.y() + n.y() * normal_scale,
-               p.z() + n.z() * normal_scale);
+    segments.insert(segments.end(), {float(p.x()), float(p.y()), float(p.z())});
+    segments.insert(segments.end(), {float(p.x() + n.x() * normal_scale),
+                                     float(p.y() + n.y() * normal_scale),
+                                     float(p.z() + n.z() * normal_scale)});
   }
-  glEnd();
+  normals_gpu.SetVertices(segments);
 }
 
+// Points and normals uploaded once as interleaved (x y z nx ny nz) attributes.
+// Normals are drawn as instanced glyphs: a two-vertex line (t = 0, 1) is
+// instanced once per point and the vertex shader places it at
+// position + t * normal_scale * normal, so changing the scale is a uniform update.
+// Only the point ranges of the current LOD selection are drawn.
+// Needs GL 3.3 (instanced arrays); Init() returns false otherwise.
+class NormalGlyphs
+{
+public:
+  bool Init()
+  {
+    if (!GLAD_GL_VERSION_3_3) return false;
+
+    // #version 120 keeps the fixed-function matrices set up by SetupViewport
+    const char *vs_src =
+        "#version 120\n"
+        "attribute float t;\n"
+        "attribute vec3 position;\n"
+        "attribute vec3 normal;\n"
+        "uniform float normal_scale;\n"
+        "void main() { gl_Position = gl_ModelViewProjectionMatrix * vec4(position + t * normal_scale * normal, 1.0); }\n";
+    const char *fs_src =
+        "#version 120\n"
+        "uniform vec3 color;\n"
+        "void main() { gl_FragColor = vec4(color, 1.0); }\n";
+
+    GLuint vs = Compile(GL_VERTEX_SHADER, vs_src);
+    GLuint fs = Compile(GL_FRAGMENT_SHADER, fs_src);
+    if (!vs || !fs) return false;
+    program_ = glCreateProgram();
+    glAttachShader(program_, vs);
+    glAttachShader(program_, fs);
+    glBindAttribLocation(program_, 0, "t"); // per-vertex attribute on location 0
+    glBindAttribLocation(program_, 1, "position");
+    glBindAttribLocation(program_, 2, "normal");
+    glLinkProgram(program_);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    GLint ok = 0;
+    glGetProgramiv(program_, GL_LINK_STATUS, &ok);
+    if (!ok)
+    {
+      Release();
+      return false;
+    }
+    scale_loc_ = glGetUniformLocation(program_, "normal_scale");
+    color_loc_ = glGetUniformLocation(program_, "color");
+
+    const float glyph[2] = {0.0f, 1.0f};
+    glGenBuffers(1, &glyph_vbo_);
+    glBindBuffer(GL_ARRAY_BUFFER, glyph_vbo_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(glyph), glyph, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+  }
+
+  void Upload(const std::vector<Point> &points, const std::vector<Vector> &normals)
+  {
+    std::vector<float> interleaved;
+    interleaved.reserve(6 * points.size());
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+      const Point &p = points[i];
+      const Vector &n = normals[i];
+      interleaved.insert(interleaved.end(), {float(p.x()), float(p.y()), float(p.z()),
+                                             float(n.x()), float(n.y()), float(n.z())});
+    }
+    if (!point_vbo_) glGenBuffers(1, &point_vbo_);
+    glBindBuffer(GL_ARRAY_BUFFER, point_vbo_);
+    glBufferData(GL_ARRAY_BUFFER, interleaved.size() * sizeof(float), interleaved.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    count_ = points.size();
+  }
+
+  void DrawNormals(const PointOctree::Selection &selection, float normal_scale, float r, float g, float b) const
+  {
+    if (count_ == 0 || selection.first.empty()) return;
+    glUseProgram(program_);
+    glUniform1f(scale_loc_, normal_scale);
+    glUniform3f(color_loc_, r, g, b);
+
+    glBindBuffer(GL_ARRAY_BUFFER, glyph_vbo_);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+    // one instanced draw per selected range, the instance attributes start at its first point
+    glBindBuffer(GL_ARRAY_BUFFER, point_vbo_);
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    for (size_t k = 0; k < selection.first.size(); ++k)
+    {
+      const size_t offset = size_t(selection.first[k]) * kStride;
+      glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, kStride, reinterpret_cast<const void *>(offset));
+      glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, kStride, reinterpret_cast<const void *>(offset + 3 * sizeof(float)));
+      glDrawArraysInstanced(GL_LINES, 0, 2, selection.count[k]);
+    }
+
+    glVertexAttribDivisor(1, 0);
+    glVertexAttribDivisor(2, 0);
+    for (GLuint k = 0; k < 3; ++k) glDisableVertexAttribArray(k);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+  }
+
+  void Release()
+  {
+    if (program_) glDeleteProgram(program_);
+    if (glyph_vbo_) glDeleteBuffers(1, &glyph_vbo_);
+    if (point_vbo_) glDeleteBuffers(1, &point_vbo_);
+    program_ = glyph_vbo_ = point_vbo_ = 0;
+    count_ = 0;
+  }
+
+private:
+  static constexpr GLsizei kStride = 6 * sizeof(float);
+
+  static GLuint Compile(GLenum type, const char *src)
+  {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &src, nullptr);
+    glCompileShader(shader);
+    GLint ok = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok)
+    {
+      char log[512];
+      glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+      std::cerr << "normal glyph shader: " << log << std::endl;
+      glDeleteShader(shader);
+      return 0;
+    }
+    return shader;
+  }
+
+  GLuint program_ = 0;
+  GLuint glyph_vbo_ = 0;
+  GLuint point_vbo_ = 0;
+  GLint scale_loc_ = -1;
+  GLint color_loc_ = -1;
+  size_t count_ = 0;
+};
+
 float camera_theta = 0.0f; // horizontal angle
 float camera_phi = 0.0f;   // vertical angle
 float camera_distance = 1.0f;
@@ -175,78 +319,250 @@ void SetupViewport(int width, int height)
   glLoadMatrixf(&view[0][0]);
 }
 
-int main(int argc, char *argv[])
+struct NormalsOptions
 {
-  if (!glfwInit()) return -1;
-
-  GLFWwindow *window = glfwCreateWindow(800, 600, "normals bunny", nullptr, nullptr);
-  glfwMakeContextCurrent(window);
-  glfwSetMouseButtonCallback(window, MouseBtnCB);
-  glfwSetCursorPosCallback(window, CursorDragCB);
-  glfwSetScrollCallback(window, ScrollCB);
-  glEnable(GL_DEPTH_TEST); // Enable depth for 3D 
+  NormalEstimator estimator = NormalEstimator::PCA;
+  Neighborhood hood; // K-nearest neighbors = 3 rings by default
+  std::size_t tile_points = 0;
+  bool binary = false; // write <name>_with_normals.pcache instead of .xyz
+  unsigned jobs = 0;   // files processed at once in --batch (0 = one per core)
+};
+
+// ../bunny.xyz -> ../bunny_with_normals.xyz (or .pcache)
+std::string OutputName(const std::string &fname, bool binary)
+{
+  const std::size_t slash = fname.find_last_of("/\\");
+  const std::size_t dot = fname.find_last_of('.');
+  const bool has_extension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+  const std::string stem = has_extension ? fname.substr(0, dot) : fname;
+  return stem + (binary ? "_with_normals.pcache" : "_with_normals.xyz");
+}
 
-  IMGUI_CHECKVERSION();
-  ImGui::CreateContext();
-  ImGui_ImplGlfw_InitForOpenGL(window, true);
-  ImGui_ImplOpenGL3_Init("#version 330");
-  ImGui::StyleColorsDark();
+// x y z nx ny nz per point, as text or as a 6 channel point cache
+bool WriteNormals(const std::string &out_name, const NormalsEngine_t &engine, bool binary)
+{
+  const std::vector<Point> &points = engine.points();
+  const std::vector<Vector> &normals = engine.normals();
+  const std::size_t n = points.size();
+  if (binary)
+  {
+    std::vector<float> channels(6 * n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      channels[i] = points[i].x();
+      channels[n + i] = points[i].y();
+      channels[2 * n + i] = points[i].z();
+      channels[3 * n + i] = normals[i].x();
+      channels[4 * n + i] = normals[i].y();
+      channels[5 * n + i] = normals[i].z();
+    }
+    PointCache cache;
+    cache.FromChannels(std::move(channels), 6);
+    return cache.Write(out_name);
+  }
+  PointWriter writer;
+  if (!writer.Open(out_name)) return false;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const float row[6] = {float(points[i].x()), float(points[i].y()), float(points[i].z()),
+                          float(normals[i].x()), float(normals[i].y()), float(normals[i].z())};
+    writer.Row(row, 6);
+  }
+  return writer.Close();
+}
 
-  const std::string fname = "../bunny.xyz";
+double MsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 
+// Load fname, estimate and orient normals, drop the unoriented points and write the result.
+// timings gets (stage, ms) for every stage.
+std::unique_ptr<NormalsEngine_t> ProcessFile(const std::string &fname, const NormalsOptions &options, unsigned threads,
+                                             bool verbose, std::vector<std::pair<std::string, double>> &timings,
+                                             std::size_t &unoriented)
+{
   // Reads a point set file in points[].
-  std::list<PointVectorPair> points;
-  if (!CGAL::IO::read_points(fname,
-                             std::back_inserter(points),
-                             CGAL::parameters::point_map(CGAL::First_of_pair_property_map<PointVectorPair>())))
+  // (through the binary point cache, written next to the file on first load)
+  auto start = std::chrono::steady_clock::now();
+  PointCache cache;
+  if (!cache.Load(fname) || cache.channels() < 3)
   {
     std::cerr << "Error: cannot read file " << fname << std::endl;
-    return EXIT_FAILURE;
+    return nullptr;
   }
+  std::vector<Point> points;
+  points.reserve(cache.size());
+  const float *x = cache.channel(0), *y = cache.channel(1), *z = cache.channel(2);
+  for (std::size_t i = 0; i < cache.size(); ++i)
+    points.emplace_back(x[i], y[i], z[i]);
+  timings.emplace_back("load", MsSince(start));
+
+  // One kd-tree and one set of neighborhoods for spacing, estimation and orientation.
+  auto engine = std::make_unique<NormalsEngine_t>(std::move(points), threads);
+  engine->set_verbose(verbose);
+  engine->BuildNeighborhoods(options.hood);
+  if (verbose) std::cout << "average spacing: " << engine->AverageSpacing() << std::endl;
 
   // Estimates normals direction.
-  // Note: pca_estimate_normals() requiresa range of points as well as property maps to access each point's position and normal.
-  const int nb_neighbors = 18; // K-nearest neighbors = 3 rings
-
-  CGAL::pca_estimate_normals<CGAL::Parallel_if_available_tag>
-      (points, nb_neighbors,
-       CGAL::parameters::point_map(CGAL::First_of_pair_property_map<PointVectorPair>())
-           .normal_map(CGAL::Second_of_pair_property_map<PointVectorPair>()));
+  if (!engine->EstimateNormals(options.estimator)) return nullptr;
 
   // Orients normals.
-  // Note: mst_orient_normals() requires a range of points as well as property maps to access each point's position and normal.
-  std::list<PointVectorPair>::iterator unoriented_points_begin =
-      CGAL::mst_orient_normals(points, nb_neighbors,
-                               CGAL::parameters::point_map(CGAL::First_of_pair_property_map<PointVectorPair>())
-                                   .normal_map(CGAL::Second_of_pair_property_map<PointVectorPair>()));
+  unoriented = engine->OrientNormals(options.tile_points);
 
   // Optional: delete points with an unoriented normal
   // if you plan to call a reconstruction algorithm that expects oriented normals.
-  points.erase(unoriented_points_begin, points.end());
+  engine->RemoveUnoriented();
+  timings.insert(timings.end(), engine->timings().begin(), engine->timings().end());
 
-  std::vector<Point> pointsToVisualize;
-  std::vector<Vector> normalsToVisualize;
-  std::ofstream outfile("../bunny_with_normals.xyz");
-  for (auto p : points)
+  start = std::chrono::steady_clock::now();
+  const std::string out_name = OutputName(fname, options.binary);
+  if (!WriteNormals(out_name, *engine, options.binary))
   {
-    auto pt = p.first;
-    auto vec = p.second;
-
-    pointsToVisualize.emplace_back(pt.x(), pt.y(), pt.z());
-    normalsToVisualize.emplace_back(vec.x(), vec.y(), vec.z());
+    std::cerr << "Error: cannot write " << out_name << std::endl;
+    return nullptr;
+  }
+  timings.emplace_back("write", MsSince(start));
+  return engine;
+}
 
-    const float x = pt.x();
-    const float nx = vec.x();
-    const float y = pt.y();
-    const float ny = vec.y();
-    const float z = pt.z();
-    const float nz = vec.z();
+// Headless: every file on its own worker, the cores split between the workers
+int RunBatch(const std::vector<std::string> &files, const NormalsOptions &options)
+{
+  const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  const unsigned jobs = std::max(1u, std::min<unsigned>(options.jobs ? options.jobs : cores, files.size()));
+  const unsigned threads = std::max(1u, cores / jobs);
+
+  const auto start = std::chrono::steady_clock::now();
+  std::atomic<std::size_t> next(0);
+  std::atomic<int> failed(0);
+  std::mutex print_mutex;
+  auto worker = [&]()
+  {
+    for (std::size_t f = next++; f < files.size(); f = next++)
+    {
+      std::vector<std::pair<std::string, double>> timings;
+      std::size_t unoriented = 0;
+      auto engine = ProcessFile(files[f], options, threads, false, timings, unoriented);
+      std::lock_guard<std::mutex> lock(print_mutex);
+      if (!engine)
+      {
+        ++failed;
+        std::cout << files[f] << ": failed" << std::endl;
+        continue;
+      }
+      std::cout << files[f] << " -> " << OutputName(files[f], options.binary) << ": " << engine->points().size()
+                << " points, " << unoriented << " unoriented removed" << std::endl;
+      for (const auto &t : timings) std::cout << "  " << t.first << ": " << t.second << " ms" << std::endl;
+    }
+  };
+  std::vector<std::thread> workers;
+  for (unsigned j = 0; j < jobs; ++j) workers.emplace_back(worker);
+  for (auto &w : workers) w.join();
+  std::cout << files.size() - failed << " of " << files.size() << " files in " << MsSince(start) << " ms (" << jobs
+            << " jobs x " << threads << " threads)" << std::endl;
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
 
-    outfile << x << " " << nx << " " << y << " " << ny << " " << z << " " << nz << "\n";
+int main(int argc, char *argv[])
+{
+  // usage: normal_bunny [--estimator pca|jet|vcm] [--k N] [--radius R] [--tile-points N] [--binary] [file.xyz]
+  //        normal_bunny --batch [--jobs N] [options] file.xyz...
+  // --radius uses all neighbors within R (capped to the k nearest when --k is given too)
+  // --tile-points orients tiles of at most N points in parallel, then reconciles them (0 = one MST)
+  // --batch runs without a window, writing <file>_with_normals.xyz (.pcache with --binary) for every file
+  std::vector<std::string> files;
+  NormalsOptions options;
+  bool k_given = false, batch = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "--estimator") == 0 && i + 1 < argc)
+    {
+      if (!ParseNormalEstimator(argv[++i], options.estimator))
+      {
+        std::cerr << "unknown estimator " << argv[i] << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+    else if (std::strcmp(argv[i], "--k") == 0 && i + 1 < argc)
+    {
+      options.hood.k = std::atoi(argv[++i]);
+      k_given = true;
+    }
+    else if (std::strcmp(argv[i], "--radius") == 0 && i + 1 < argc)
+      options.hood.radius = std::atof(argv[++i]);
+    else if (std::strcmp(argv[i], "--tile-points") == 0 && i + 1 < argc)
+      options.tile_points = std::strtoull(argv[++i], nullptr, 10);
+    else if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+      options.jobs = std::atoi(argv[++i]);
+    else if (std::strcmp(argv[i], "--binary") == 0)
+      options.binary = true;
+    else if (std::strcmp(argv[i], "--batch") == 0)
+      batch = true;
+    else
+      files.push_back(argv[i]);
   }
+  if (options.hood.radius > 0.0 && !k_given) options.hood.k = 0;
+  if (files.empty()) files.push_back("../bunny.xyz");
+  if (batch) return RunBatch(files, options);
+
+  std::vector<std::pair<std::string, double>> timings;
+  std::size_t unoriented = 0;
+  std::unique_ptr<NormalsEngine_t> engine = ProcessFile(files.front(), options, 0, true, timings, unoriented);
+  if (!engine) return EXIT_FAILURE;
+  std::cout << "unoriented points: " << unoriented << " (removed), wrote " << OutputName(files.front(), options.binary)
+            << std::endl;
+
+  std::vector<Point> pointsToVisualize(engine->points());
+  std::vector<Vector> normalsToVisualize(engine->normals());
+  engine.reset();
+
+  if (!glfwInit()) return -1;
+
+  GLFWwindow *window = glfwCreateWindow(800, 600, "normals bunny", nullptr, nullptr);
+  glfwMakeContextCurrent(window);
+  gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+  glfwSetMouseButtonCallback(window, MouseBtnCB);
+  glfwSetCursorPosCallback(window, CursorDragCB);
+  glfwSetScrollCallback(window, ScrollCB);
+  glEnable(GL_DEPTH_TEST); // Enable depth for 3D 
+
+  IMGUI_CHECKVERSION();
+  ImGui::CreateContext();
+  ImGui_ImplGlfw_InitForOpenGL(window, true);
+  ImGui_ImplOpenGL3_Init("#version 330");
+  ImGui::StyleColorsDark();
 
   pointsToVisualize = std::move(NormalizePoints(pointsToVisualize));
 
+  // LOD octree over the normalized points; points and normals are kept in octree
+  // order from here on so a selection is a set of ranges for both
+  LodPoints lod_points;
+  lod_points.Build(FlattenPoints3(pointsToVisualize));
+  {
+    std::vector<Point> ordered_points;
+    std::vector<Vector> ordered_normals;
+    ordered_points.reserve(pointsToVisualize.size());
+    ordered_normals.reserve(normalsToVisualize.size());
+    for (std::uint32_t i : lod_points.octree().order())
+    {
+      ordered_points.push_back(pointsToVisualize[i]);
+      ordered_normals.push_back(normalsToVisualize[i]);
+    }
+    pointsToVisualize.swap(ordered_points);
+    normalsToVisualize.swap(ordered_normals);
+  }
+
+  // instanced glyphs when available, otherwise CPU-built segments re-uploaded on scale changes
+  float normal_scale = 0.05f;
+  NormalGlyphs glyphs;
+  const bool instanced = glyphs.Init();
+  GeometryBuffer normals_gpu;
+  if (instanced)
+    glyphs.Upload(pointsToVisualize, normalsToVisualize);
+  else
+    UploadNormalSegments(pointsToVisualize, normalsToVisualize, normals_gpu, normal_scale);
+
   while (!glfwWindowShouldClose(window))
   {
     glfwPollEvents();
@@ -255,13 +571,39 @@ int main(int argc, char *argv[])
     ImGui::NewFrame();
 
     SetupViewport(800, 600);
-    RenderPointsWithNormals(pointsToVisualize, normalsToVisualize);
+    glPointSize(4.0f);
+    glColor3f(1.0f, 1.0f, 1.0f);
+    lod_points.Draw();
+    const PointOctree::Selection &selection = lod_points.selection();
+    if (instanced)
+      glyphs.DrawNormals(selection, normal_scale, 1.0f, 0.2f, 0.2f);
+    else
+    {
+      // two segment vertices per point
+      std::vector<GLint> first(selection.first.size());
+      std::vector<GLsizei> count(selection.count.size());
+      for (size_t k = 0; k < first.size(); ++k)
+      {
+        first[k] = 2 * selection.first[k];
+        count[k] = 2 * selection.count[k];
+      }
+      glColor3f(1.0f, 0.2f, 0.2f);
+      normals_gpu.DrawRanges(GL_LINES, first, count);
+    }
+
+    if (ImGui::SliderFloat("normal scale", &normal_scale, 0.0f, 0.2f) && !instanced)
+      UploadNormalSegments(pointsToVisualize, normalsToVisualize, normals_gpu, normal_scale);
+    ImGui::Text("#points: %zu (drawn %zu, %s)", pointsToVisualize.size(), lod_points.drawn(),
+                instanced ? "instanced glyphs" : "segments");
 
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
     glfwSwapBuffers(window);
   }
 
+  glyphs.Release();
+  lod_points.Release();
+  normals_gpu.Release();
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
@@ -0,0 +1,200 @@
+#pragma once
+
+// Binary mesh cache.
+//
+// The first load of an OFF file parses it (off_loader.h), puts the triangles
+// in meshlet order (meshlets.h) and writes <file>.mcache next to it; later
+// loads memory-map the cache and hand the vertex and index blobs to the GPU
+// upload directly, without building the std::vector copies in Mesh.
+//
+// Layout (native endianness):
+//   MeshCacheHeader (80 bytes)
+//   vertex blob: vertex_count * 3 floats (x,y,z)
+//   index blob:  index_count uint32 (triangle list, meshlet order with kMeshletOrder)
+//
+// The header records size and mtime of the OFF source, a cache that does not
+// match them is rebuilt.
+
+#include "mapped_file.h"
+#include "meshlets.h"
+#include "off_loader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility>
+
+struct MeshCacheHeader
+{
+    char magic[8];          // "MCACHE\0\0"
+    std::uint32_t version;  // 3
+    std::uint32_t flags;    // MeshCache::kOptimized, kMeshletOrder
+    std::uint64_t vertex_count;
+    std::uint64_t index_count;
+    std::uint64_t source_size;
+    std::int64_t source_mtime;
+    float bbox_min[3];
+    float bbox_max[3];
+    std::uint8_t pad[8];
+};
+static_assert(sizeof(MeshCacheHeader) == 80, "MeshCacheHeader must stay 80 bytes");
+static_assert(sizeof(unsigned int) == sizeof(std::uint32_t), "Mesh::indices is written as uint32");
+
+class MeshCache
+{
+public:
+    static constexpr std::uint32_t kVersion = 3; // 3: every cache is in meshlet order
+    static constexpr std::uint32_t kOptimized = 1; // meshlet, vertex cache and fetch order applied (mesh_optimize.h)
+    static constexpr std::uint32_t kMeshletOrder = 2; // triangles in runs of kMeshletTriangles, uploaded as is
+
+    // Load filename through its binary cache, creating or refreshing the cache as needed.
+    // use_iostream selects the original OFF reader when the file has to be parsed.
+    bool Load(const std::string &filename, bool use_cache = true, bool use_iostream = false)
+    {
+        const std::string cache_name = filename + ".mcache";
+        std::uint64_t src_size = 0;
+        std::int64_t src_mtime = 0;
+        const bool has_source = FileStamp(filename, src_size, src_mtime);
+
+        if (use_cache && (has_source ? MapFresh(cache_name, src_size, src_mtime) : Map(cache_name)))
+        {
+            std::cout << "mapped " << cache_name << "\n";
+            return true;
+        }
+
+        Reset();
+        if (!(use_iostream ? LoadOFFIostream(filename, owned_) : LoadOFF(filename, owned_))) return false;
+        {
+            // once per source: later loads map the ordered triangles
+            const std::vector<std::uint32_t> ordered = MeshletTriangleOrder(
+                owned_.vertices.data(), owned_.vertices.size() / 3, owned_.indices.data(), owned_.indices.size());
+            owned_.indices.assign(ordered.begin(), ordered.end());
+        }
+        SetHeader(owned_, src_size, src_mtime);
+        header_storage_.flags = kMeshletOrder;
+        vertices_ = owned_.vertices.data();
+        indices_ = owned_.indices.data();
+        if (use_cache && !Write(cache_name))
+            std::cerr << "Could not write mesh cache " << cache_name << "\n";
+        return true;
+    }
+
+    // Memory-map an existing cache file
+    bool Map(const std::string &cache_name)
+    {
+        Reset();
+        if (!file_.Open(cache_name) || file_.size() < sizeof(MeshCacheHeader)) return false;
+        std::memcpy(&header_storage_, file_.data(), sizeof(MeshCacheHeader));
+        const MeshCacheHeader &h = header_storage_;
+        const std::uint64_t expected = sizeof(MeshCacheHeader) + h.vertex_count * 3 * sizeof(float) +
+                                       h.index_count * sizeof(std::uint32_t);
+        if (std::memcmp(h.magic, "MCACHE", 6) != 0 || h.version != kVersion || file_.size() != expected)
+        {
+            file_.Close();
+            return false;
+        }
+        header_ = &header_storage_;
+        vertices_ = reinterpret_cast<const float *>(file_.data() + sizeof(MeshCacheHeader));
+        indices_ = reinterpret_cast<const std::uint32_t *>(vertices_ + h.vertex_count * 3);
+        return true;
+    }
+
+    // Take over an in-memory mesh derived from the source with the given stamp
+    void Adopt(Mesh mesh, std::uint64_t src_size, std::int64_t src_mtime, std::uint32_t flags = 0)
+    {
+        Reset();
+        owned_ = std::move(mesh);
+        SetHeader(owned_, src_size, src_mtime);
+        header_storage_.flags = flags;
+        vertices_ = owned_.vertices.data();
+        indices_ = owned_.indices.data();
+    }
+
+    // Swap in a processed version of the current mesh, keeping the source stamp so the
+    // result can be written back as the cache of the same OFF file
+    void Replace(Mesh mesh, std::uint32_t flags)
+    {
+        const std::uint64_t src_size = header_ ? header_->source_size : 0;
+        const std::int64_t src_mtime = header_ ? header_->source_mtime : 0;
+        Adopt(std::move(mesh), src_size, src_mtime, flags);
+    }
+
+    // Map cache_name only if it was made from a source with this size and mtime
+    bool MapFresh(const std::string &cache_name, std::uint64_t src_size, std::int64_t src_mtime)
+    {
+        if (Map(cache_name) && header_->source_size == src_size && header_->source_mtime == src_mtime) return true;
+        Reset();
+        return false;
+    }
+
+    bool Write(const std::string &cache_name) const
+    {
+        if (!header_) return false;
+        const std::string tmp_name = cache_name + ".tmp";
+        {
+            std::ofstream out(tmp_name, std::ios::binary);
+            if (!out) return false;
+            out.write(reinterpret_cast<const char *>(header_), sizeof(MeshCacheHeader));
+            out.write(reinterpret_cast<const char *>(vertices_), vertex_bytes());
+            out.write(reinterpret_cast<const char *>(indices_), index_bytes());
+            if (!out) return false;
+        }
+        return std::rename(tmp_name.c_str(), cache_name.c_str()) == 0;
+    }
+
+    std::size_t vertex_count() const { return header_ ? header_->vertex_count : 0; }
+    std::size_t index_count() const { return header_ ? header_->index_count : 0; }
+    std::size_t vertex_bytes() const { return vertex_count() * 3 * sizeof(float); }
+    std::size_t index_bytes() const { return index_count() * sizeof(std::uint32_t); }
+    const float *vertices() const { return vertices_; }
+    const std::uint32_t *indices() const { return indices_; }
+    const float *bbox_min() const { return header_->bbox_min; }
+    const float *bbox_max() const { return header_->bbox_max; }
+    std::uint32_t flags() const { return header_ ? header_->flags : 0; }
+    bool mapped() const { return file_.is_open(); }
+
+private:
+    void SetHeader(const Mesh &mesh, std::uint64_t src_size, std::int64_t src_mtime)
+    {
+        MeshCacheHeader &h = header_storage_;
+        std::memset(&h, 0, sizeof(h));
+        std::memcpy(h.magic, "MCACHE", 6);
+        h.version = kVersion;
+        h.vertex_count = mesh.vertices.size() / 3;
+        h.index_count = mesh.indices.size();
+        h.source_size = src_size;
+        h.source_mtime = src_mtime;
+        for (int k = 0; k < 3; ++k)
+        {
+            h.bbox_min[k] = std::numeric_limits<float>::max();
+            h.bbox_max[k] = std::numeric_limits<float>::lowest();
+        }
+        for (std::size_t i = 0; i < mesh.vertices.size(); ++i)
+        {
+            h.bbox_min[i % 3] = std::min(h.bbox_min[i % 3], mesh.vertices[i]);
+            h.bbox_max[i % 3] = std::max(h.bbox_max[i % 3], mesh.vertices[i]);
+        }
+        header_ = &h;
+    }
+
+    void Reset()
+    {
+        file_.Close();
+        owned_ = Mesh();
+        header_ = nullptr;
+        vertices_ = nullptr;
+        indices_ = nullptr;
+    }
+
+    MappedFile file_;
+    Mesh owned_; // only used when the OFF file was parsed this run
+    MeshCacheHeader header_storage_{};
+    const MeshCacheHeader *header_ = nullptr;
+    const float *vertices_ = nullptr;
+    const std::uint32_t *indices_ = nullptr;
+};
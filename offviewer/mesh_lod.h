@@ -0,0 +1,170 @@
+#pragma once
+
+// Level-of-detail chain built with CGAL's edge-collapse simplification.
+//
+// One Surface_mesh is built from the full-resolution mesh and decimated down
+// the face ratios one after another (Lindstrom-Turk cost and placement, the
+// CGAL defaults), so each level starts from the previous one and only one
+// mesh is held in memory. Levels are stored next to the OFF file as <file>.lod<percent>.mcache
+// with the source stamp of the OFF file, so the chain is only rebuilt when the
+// mesh changes. SelectLod() picks a level from the camera distance.
+
+#include "mesh_cache.h"
+#include "mesh_optimize.h"
+
+#include <CGAL/Simple_cartesian.h>
+#include <CGAL/Surface_mesh.h>
+#include <CGAL/Surface_mesh_simplification/edge_collapse.h>
+#include <CGAL/version.h>
+#if CGAL_VERSION_NR >= CGAL_VERSION_NUMBER(5, 6, 0)
+#include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/Face_count_ratio_stop_predicate.h>
+#else
+#include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/Count_ratio_stop_predicate.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace mesh_lod_detail
+{
+typedef CGAL::Simple_cartesian<double> Kernel_t;
+typedef CGAL::Surface_mesh<Kernel_t::Point_3> Surface_mesh_t;
+#if CGAL_VERSION_NR >= CGAL_VERSION_NUMBER(5, 6, 0)
+typedef CGAL::Surface_mesh_simplification::Face_count_ratio_stop_predicate<Surface_mesh_t> Stop_t;
+#else
+// counts edges, which scale with faces on a closed triangle mesh
+typedef CGAL::Surface_mesh_simplification::Count_ratio_stop_predicate<Surface_mesh_t> Stop_t;
+#endif
+
+// Build a Surface_mesh from the triangle list, skipping faces that would make it non-manifold
+inline Surface_mesh_t ToSurfaceMesh(const float *vertices, std::size_t n_vertices, const std::uint32_t *indices,
+                                    std::size_t n_indices)
+{
+    Surface_mesh_t sm;
+    sm.reserve(n_vertices, n_indices / 2, n_indices / 3); // edges ~ 1.5 faces
+    std::vector<Surface_mesh_t::Vertex_index> handles(n_vertices);
+    for (std::size_t i = 0; i < n_vertices; ++i)
+        handles[i] = sm.add_vertex(Kernel_t::Point_3(vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2]));
+    std::size_t skipped = 0;
+    for (std::size_t t = 0; t + 2 < n_indices; t += 3)
+    {
+        if (sm.add_face(handles[indices[t]], handles[indices[t + 1]], handles[indices[t + 2]]) ==
+            Surface_mesh_t::null_face())
+            ++skipped;
+    }
+    if (skipped > 0) std::cerr << "simplification: skipped " << skipped << " non-manifold faces\n";
+    return sm;
+}
+
+inline Mesh FromSurfaceMesh(Surface_mesh_t &sm)
+{
+    sm.collect_garbage();
+    Mesh mesh;
+    mesh.vertices.reserve(3 * sm.number_of_vertices());
+    for (auto v : sm.vertices())
+    {
+        const auto &p = sm.point(v);
+        mesh.vertices.insert(mesh.vertices.end(), {float(p.x()), float(p.y()), float(p.z())});
+    }
+    mesh.indices.reserve(3 * sm.number_of_faces());
+    for (auto f : sm.faces())
+        for (auto v : CGAL::vertices_around_face(sm.halfedge(f), sm))
+            mesh.indices.push_back(static_cast<unsigned int>(v.idx()));
+    return mesh;
+}
+} // namespace mesh_lod_detail
+
+// One simplified level, face_ratio of the full mesh
+struct MeshLod
+{
+    double face_ratio = 1.0;
+    MeshCache mesh;
+};
+
+inline std::string LodCacheName(const std::string &filename, double face_ratio)
+{
+    return filename + ".lod" + std::to_string(static_cast<int>(std::lround(face_ratio * 100.0))) + ".mcache";
+}
+
+// Load the chain from its caches, (re)building stale or missing levels.
+// full: the loaded full-resolution mesh of filename.
+inline std::vector<std::unique_ptr<MeshLod>> LoadLodChain(const std::string &filename, const MeshCache &full,
+                                                          const std::vector<double> &face_ratios = {0.5, 0.25, 0.1, 0.01},
+                                                          bool use_cache = true)
+{
+    using namespace mesh_lod_detail;
+    std::uint64_t src_size = 0;
+    std::int64_t src_mtime = 0;
+    FileStamp(filename, src_size, src_mtime);
+
+    std::vector<std::unique_ptr<MeshLod>> chain;
+    std::vector<std::size_t> missing;
+    for (double ratio : face_ratios)
+    {
+        chain.push_back(std::make_unique<MeshLod>());
+        chain.back()->face_ratio = ratio;
+        if (!use_cache || !chain.back()->mesh.MapFresh(LodCacheName(filename, ratio), src_size, src_mtime))
+            missing.push_back(chain.size() - 1);
+    }
+    if (missing.empty()) return chain;
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<Mesh> built(missing.size());
+    // finest missing level first, each coarser one continues from it
+    std::vector<std::size_t> order(missing.size());
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b)
+              { return chain[missing[a]]->face_ratio > chain[missing[b]]->face_ratio; });
+
+    Surface_mesh_t sm = ToSurfaceMesh(full.vertices(), full.vertex_count(), full.indices(), full.index_count());
+    const double full_faces = static_cast<double>(sm.number_of_faces());
+    for (std::size_t k : order)
+    {
+        // the ratio is relative to the faces left from the previous level
+        const double ratio = std::min(1.0, chain[missing[k]]->face_ratio * full_faces /
+                                               std::max<double>(static_cast<double>(sm.number_of_faces()), 1.0));
+#if CGAL_VERSION_NR >= CGAL_VERSION_NUMBER(5, 6, 0)
+        Stop_t stop(ratio, sm);
+#else
+        Stop_t stop(ratio);
+#endif
+        CGAL::Surface_mesh_simplification::edge_collapse(sm, stop);
+        Mesh mesh = FromSurfaceMesh(sm);
+        // simplification scrambles the order, restore meshlet and vertex locality
+        built[k] = OptimizeMesh(mesh.vertices.data(), mesh.vertices.size() / 3, mesh.indices.data(),
+                                mesh.indices.size());
+    }
+
+    for (std::size_t k = 0; k < missing.size(); ++k)
+    {
+        MeshLod &lod = *chain[missing[k]];
+        lod.mesh.Adopt(std::move(built[k]), src_size, src_mtime, MeshCache::kOptimized | MeshCache::kMeshletOrder);
+        std::cout << "LOD " << lod.face_ratio * 100.0 << "%: " << lod.mesh.index_count() / 3 << " faces\n";
+        if (use_cache && !lod.mesh.Write(LodCacheName(filename, lod.face_ratio)))
+            std::cerr << "Could not write " << LodCacheName(filename, lod.face_ratio) << "\n";
+    }
+    std::cout << "built " << missing.size() << " LOD levels in "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s\n";
+    return chain;
+}
+
+// Level for a mesh of bounding radius seen from distance with a vertical field of view fov_y:
+// the coarsest level whose face ratio still covers the projected area of the mesh
+// (0 = full resolution, k = chain[k - 1])
+inline std::size_t SelectLod(const std::vector<std::unique_ptr<MeshLod>> &chain, float radius, float distance,
+                             float fov_y)
+{
+    const float screen_fraction = radius / (std::max(distance, 1e-6f) * std::tan(0.5f * fov_y));
+    const double area = double(screen_fraction) * screen_fraction;
+    std::size_t level = 0;
+    for (std::size_t k = 0; k < chain.size(); ++k)
+        if (chain[k]->face_ratio >= area) level = k + 1;
+    return level;
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+// Post-transform vertex cache and vertex fetch optimization.
+//
+// OptimizeVertexCache() reorders triangles with Tipsify (Sander, Nehab and
+// Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced
+// Overdraw", 2007): it fans around the most recently used vertex that still
+// has triangles left and stays in the cache, in linear time.
+// OptimizeVertexFetch() then renumbers vertices in order of first use so the
+// vertex buffer is read front to back; unreferenced vertices are dropped.
+// OptimizeMesh() clusters the triangles into meshlets first and runs Tipsify
+// inside each meshlet, so the result is still in meshlet order and the viewer
+// uploads the optimized order as is.
+// AnalyzeVertexCache() simulates a FIFO cache and reports
+//   ACMR: cache misses per triangle (0.5 is the ideal for large grids, 3 the worst)
+//   ATVR: cache misses per referenced vertex (1 is ideal)
+
+#include "meshlets.h"
+#include "off_loader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+struct VertexCacheStats
+{
+    double acmr = 0.0;
+    double atvr = 0.0;
+};
+
+inline VertexCacheStats AnalyzeVertexCache(const std::uint32_t *indices, std::size_t n_indices, std::size_t n_vertices,
+                                           unsigned cache_size = 16)
+{
+    VertexCacheStats stats;
+    if (n_indices < 3) return stats;
+    // a vertex is cached if fewer than cache_size misses happened since it was loaded
+    std::vector<std::uint64_t> loaded_at(n_vertices, 0);
+    std::vector<char> used(n_vertices, 0);
+    std::uint64_t misses = 0;
+    std::size_t referenced = 0;
+    for (std::size_t i = 0; i < n_indices; ++i)
+    {
+        const std::uint32_t v = indices[i];
+        if (!used[v])
+        {
+            used[v] = 1;
+            ++referenced;
+        }
+        if (loaded_at[v] == 0 || misses + 1 - loaded_at[v] > cache_size)
+            loaded_at[v] = ++misses;
+    }
+    stats.acmr = double(misses) / double(n_indices / 3);
+    stats.atvr = referenced ? double(misses) / double(referenced) : 0.0;
+    return stats;
+}
+
+// Tipsify triangle order for a cache of cache_size entries
+inline std::vector<std::uint32_t> OptimizeVertexCache(const std::uint32_t *indices, std::size_t n_indices,
+                                                      std::size_t n_vertices, unsigned cache_size = 16)
+{
+    const std::size_t n_triangles = n_indices / 3;
+    std::vector<std::uint32_t> out;
+    out.reserve(n_triangles * 3);
+    if (n_triangles == 0) return out;
+
+    // vertex -> triangles adjacency (CSR)
+    std::vector<std::uint32_t> live(n_vertices, 0);
+    for (std::size_t i = 0; i < 3 * n_triangles; ++i) ++live[indices[i]];
+    std::vector<std::size_t> offsets(n_vertices + 1, 0);
+    for (std::size_t v = 0; v < n_vertices; ++v) offsets[v + 1] = offsets[v] + live[v];
+    std::vector<std::uint32_t> adjacency(offsets[n_vertices]);
+    {
+        std::vector<std::size_t> fill(offsets.begin(), offsets.end() - 1);
+        for (std::size_t t = 0; t < n_triangles; ++t)
+            for (int k = 0; k < 3; ++k) adjacency[fill[indices[3 * t + k]]++] = static_cast<std::uint32_t>(t);
+    }
+
+    std::vector<std::uint64_t> cache_time(n_vertices, 0);
+    std::vector<char> emitted(n_triangles, 0);
+    std::vector<std::uint32_t> dead_end; // recently referenced vertices
+    std::vector<std::uint32_t> candidates;
+    std::uint64_t time = cache_size + 1;
+    std::size_t cursor = 0; // next vertex to try when the dead-end stack runs dry
+
+    auto skip_dead_end = [&]() -> std::int64_t
+    {
+        while (!dead_end.empty())
+        {
+            const std::uint32_t d = dead_end.back();
+            dead_end.pop_back();
+            if (live[d] > 0) return d;
+        }
+        for (; cursor < n_vertices; ++cursor)
+            if (live[cursor] > 0) return static_cast<std::int64_t>(cursor);
+        return -1;
+    };
+
+    std::int64_t fan = skip_dead_end();
+    while (fan >= 0)
+    {
+        candidates.clear();
+        for (std::size_t a = offsets[fan]; a < offsets[fan + 1]; ++a)
+        {
+            const std::uint32_t t = adjacency[a];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+            for (int k = 0; k < 3; ++k)
+            {
+                const std::uint32_t v = indices[3 * t + k];
+                out.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (time - cache_time[v] > cache_size) cache_time[v] = time++;
+            }
+        }
+
+        // next fan: the candidate still in cache after emitting its remaining triangles, oldest first
+        std::int64_t next = -1;
+        std::int64_t best = -1;
+        for (std::uint32_t v : candidates)
+        {
+            if (live[v] == 0) continue;
+            std::int64_t priority = 0;
+            if (time - cache_time[v] + 2 * live[v] <= cache_size) priority = static_cast<std::int64_t>(time - cache_time[v]);
+            if (priority > best)
+            {
+                best = priority;
+                next = v;
+            }
+        }
+        fan = next >= 0 ? next : skip_dead_end();
+    }
+    return out;
+}
+
+// Renumber vertices by first use; returns the new vertex array, rewrites indices in place
+inline std::vector<float> OptimizeVertexFetch(const float *vertices, std::size_t n_vertices,
+                                              std::vector<std::uint32_t> &indices)
+{
+    const std::uint32_t unused = 0xffffffffu;
+    std::vector<std::uint32_t> remap(n_vertices, unused);
+    std::vector<float> out;
+    out.reserve(3 * n_vertices);
+    std::uint32_t next = 0;
+    for (std::uint32_t &i : indices)
+    {
+        if (remap[i] == unused)
+        {
+            remap[i] = next++;
+            out.insert(out.end(), vertices + 3 * std::size_t(i), vertices + 3 * std::size_t(i) + 3);
+        }
+        i = remap[i];
+    }
+    return out;
+}
+
+// Both passes, with statistics before and after
+inline Mesh OptimizeMesh(const float *vertices, std::size_t n_vertices, const std::uint32_t *indices,
+                         std::size_t n_indices, unsigned cache_size = 16)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const VertexCacheStats before = AnalyzeVertexCache(indices, n_indices, n_vertices, cache_size);
+
+    // meshlet order, then Tipsify on every meshlet with its vertices numbered locally
+    std::vector<std::uint32_t> reordered = MeshletTriangleOrder(vertices, n_vertices, indices, n_indices);
+    const std::uint32_t unused = 0xffffffffu;
+    std::vector<std::uint32_t> to_local(n_vertices, unused), to_global, local;
+    for (std::size_t begin = 0; begin < reordered.size(); begin += 3 * kMeshletTriangles)
+    {
+        const std::size_t end = std::min(begin + 3 * kMeshletTriangles, reordered.size());
+        local.clear();
+        to_global.clear();
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            std::uint32_t &l = to_local[reordered[i]];
+            if (l == unused)
+            {
+                l = static_cast<std::uint32_t>(to_global.size());
+                to_global.push_back(reordered[i]);
+            }
+            local.push_back(l);
+        }
+        const std::vector<std::uint32_t> order =
+            OptimizeVertexCache(local.data(), local.size(), to_global.size(), cache_size);
+        for (std::size_t i = 0; i < order.size(); ++i) reordered[begin + i] = to_global[order[i]];
+        for (std::uint32_t v : to_global) to_local[v] = unused;
+    }
+    Mesh mesh;
+    mesh.vertices = OptimizeVertexFetch(vertices, n_vertices, reordered);
+    mesh.indices.assign(reordered.begin(), reordered.end());
+
+    const VertexCacheStats after =
+        AnalyzeVertexCache(reordered.data(), reordered.size(), mesh.vertices.size() / 3, cache_size);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "vertex cache (" << cache_size << " entries): ACMR " << before.acmr << " -> " << after.acmr
+              << ", ATVR " << before.atvr << " -> " << after.atvr << " (" << ms << " ms)\n";
+    if (mesh.vertices.size() / 3 != n_vertices)
+        std::cout << "dropped " << n_vertices - mesh.vertices.size() / 3 << " unreferenced vertices\n";
+    return mesh;
+}
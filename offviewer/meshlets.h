@@ -0,0 +1,214 @@
+#pragma once
+
+// Meshlets: the triangle list split into small spatially coherent clusters.
+//
+// MeshletTriangleOrder() orders triangles by the Morton code of their centroid
+// on a coarse grid (stable, so the input order inside a cell is kept); the mesh
+// cache stores that order (mesh_optimize.h also reorders triangles inside each
+// run for the vertex cache). BuildMeshlets() cuts a triangle list into runs of
+// at most max_triangles in place, without copying it, so the cached order is
+// the one the GPU sees. Every meshlet stores a bounding sphere and a normal
+// cone (axis + cutoff, as in meshoptimizer) so the viewer can drop meshlets
+// that are outside the frustum or entirely back-facing.
+// CullMeshlets() turns the surviving meshlets into a glMultiDrawElements list,
+// merging neighbours that are contiguous in the index buffer.
+
+#include "frustum.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+// Triangles per meshlet, shared with the vertex cache optimization
+constexpr std::size_t kMeshletTriangles = 256;
+
+struct Meshlet
+{
+    float center[3];
+    float radius;
+    float cone_axis[3];
+    float cone_cutoff;          // > 1 disables cone culling
+    std::uint32_t first_index;  // into the reordered index buffer
+    std::uint32_t index_count;
+};
+
+// Arguments for glMultiDrawElements
+struct MeshletDrawList
+{
+    std::vector<int> counts;
+    std::vector<const void *> offsets; // byte offsets into the element buffer
+    std::size_t triangles = 0;
+    std::size_t meshlets = 0;
+};
+
+namespace meshlet_detail
+{
+inline std::uint32_t Spread10(std::uint32_t v)
+{
+    v &= 0x3ff;
+    v = (v | v << 16) & 0x030000ff;
+    v = (v | v << 8) & 0x0300f00f;
+    v = (v | v << 4) & 0x030c30c3;
+    v = (v | v << 2) & 0x09249249;
+    return v;
+}
+} // namespace meshlet_detail
+
+// Triangle list reordered so that runs of kMeshletTriangles are spatially coherent
+inline std::vector<std::uint32_t> MeshletTriangleOrder(const float *vertices, std::size_t n_vertices,
+                                                       const std::uint32_t *indices, std::size_t n_indices)
+{
+    using namespace meshlet_detail;
+    const std::size_t n_triangles = n_indices / 3;
+    std::vector<std::uint32_t> out_indices;
+    if (n_triangles == 0 || n_vertices == 0) return out_indices;
+
+    float lo[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                   std::numeric_limits<float>::max()};
+    float hi[3] = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(),
+                   std::numeric_limits<float>::lowest()};
+    for (std::size_t i = 0; i < n_vertices; ++i)
+        for (int k = 0; k < 3; ++k)
+        {
+            lo[k] = std::min(lo[k], vertices[3 * i + k]);
+            hi[k] = std::max(hi[k], vertices[3 * i + k]);
+        }
+    const float extent = std::max({hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2], 1e-20f});
+
+    // 10 bits per axis: cells are coarse enough that the input order inside them survives
+    std::vector<std::uint32_t> codes(n_triangles);
+    for (std::size_t t = 0; t < n_triangles; ++t)
+    {
+        std::uint32_t q[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            const float c = (vertices[3 * indices[3 * t] + k] + vertices[3 * indices[3 * t + 1] + k] +
+                             vertices[3 * indices[3 * t + 2] + k]) / 3.0f;
+            q[k] = std::min<std::uint32_t>(static_cast<std::uint32_t>((c - lo[k]) / extent * 1024.0f), 1023);
+        }
+        codes[t] = Spread10(q[0]) << 2 | Spread10(q[1]) << 1 | Spread10(q[2]);
+    }
+    std::vector<std::uint32_t> order(n_triangles);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) { return codes[a] < codes[b]; });
+
+    out_indices.resize(3 * n_triangles);
+    for (std::size_t t = 0; t < n_triangles; ++t)
+        for (int k = 0; k < 3; ++k) out_indices[3 * t + k] = indices[3 * order[t] + k];
+    return out_indices;
+}
+
+// vertices: xyz per vertex, indices: triangle list, best in meshlet order (MeshletTriangleOrder).
+// Returns the meshlets over consecutive runs of indices, which is uploaded unchanged.
+inline std::vector<Meshlet> BuildMeshlets(const float *vertices, std::size_t n_vertices, const std::uint32_t *indices,
+                                          std::size_t n_indices, std::size_t max_triangles = kMeshletTriangles)
+{
+    std::vector<Meshlet> meshlets;
+    const std::size_t n_triangles = n_indices / 3;
+    if (n_triangles == 0 || n_vertices == 0) return meshlets;
+
+    meshlets.reserve((n_triangles + max_triangles - 1) / max_triangles);
+    for (std::size_t begin = 0; begin < n_triangles; begin += max_triangles)
+    {
+        const std::size_t end = std::min(begin + max_triangles, n_triangles);
+        Meshlet m;
+        m.first_index = static_cast<std::uint32_t>(3 * begin);
+        m.index_count = static_cast<std::uint32_t>(3 * (end - begin));
+
+        // bounding sphere around the box center
+        float mlo[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                        std::numeric_limits<float>::max()};
+        float mhi[3] = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(),
+                        std::numeric_limits<float>::lowest()};
+        for (std::size_t i = 3 * begin; i < 3 * end; ++i)
+            for (int k = 0; k < 3; ++k)
+            {
+                mlo[k] = std::min(mlo[k], vertices[3 * indices[i] + k]);
+                mhi[k] = std::max(mhi[k], vertices[3 * indices[i] + k]);
+            }
+        for (int k = 0; k < 3; ++k) m.center[k] = 0.5f * (mlo[k] + mhi[k]);
+        float r2 = 0.0f;
+        for (std::size_t i = 3 * begin; i < 3 * end; ++i)
+        {
+            const float *v = &vertices[3 * indices[i]];
+            const float dx = v[0] - m.center[0], dy = v[1] - m.center[1], dz = v[2] - m.center[2];
+            r2 = std::max(r2, dx * dx + dy * dy + dz * dz);
+        }
+        m.radius = std::sqrt(r2);
+
+        // normal cone: average of the unit face normals, cutoff from the widest deviation
+        std::vector<float> normals;
+        normals.reserve(3 * (end - begin));
+        float axis[3] = {0.0f, 0.0f, 0.0f};
+        for (std::size_t t = begin; t < end; ++t)
+        {
+            const float *a = &vertices[3 * indices[3 * t]];
+            const float *b = &vertices[3 * indices[3 * t + 1]];
+            const float *c = &vertices[3 * indices[3 * t + 2]];
+            const float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+            const float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+            float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            const float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (len == 0.0f) continue; // degenerate, no orientation
+            for (int k = 0; k < 3; ++k)
+            {
+                n[k] /= len;
+                axis[k] += n[k];
+                normals.push_back(n[k]);
+            }
+        }
+        const float axis_len = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        m.cone_cutoff = 2.0f;
+        std::fill(m.cone_axis, m.cone_axis + 3, 0.0f);
+        if (axis_len > 0.0f)
+        {
+            float min_dot = 1.0f;
+            for (int k = 0; k < 3; ++k) m.cone_axis[k] = axis[k] / axis_len;
+            for (std::size_t i = 0; i < normals.size(); i += 3)
+                min_dot = std::min(min_dot, normals[i] * m.cone_axis[0] + normals[i + 1] * m.cone_axis[1] +
+                                                normals[i + 2] * m.cone_axis[2]);
+            // wider than ~85 degrees: some triangle faces the camera from almost anywhere
+            if (min_dot > 0.1f) m.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+        }
+        meshlets.push_back(m);
+    }
+    return meshlets;
+}
+
+// mvp: column-major, eye: camera position in model space
+inline void CullMeshlets(const std::vector<Meshlet> &meshlets, const float mvp[16], const float eye[3],
+                         bool frustum_culling, bool cone_culling, MeshletDrawList &list)
+{
+    list.counts.clear();
+    list.offsets.clear();
+    list.triangles = 0;
+    list.meshlets = 0;
+    const Frustum frustum(mvp);
+    std::size_t run_end = std::numeric_limits<std::size_t>::max(); // end of the last emitted range
+    for (const Meshlet &m : meshlets)
+    {
+        if (frustum_culling && !frustum.SphereVisible(m.center, m.radius)) continue;
+        if (cone_culling)
+        {
+            // back-facing from every point of the bounding sphere
+            const float d[3] = {m.center[0] - eye[0], m.center[1] - eye[1], m.center[2] - eye[2]};
+            const float dist = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+            if (d[0] * m.cone_axis[0] + d[1] * m.cone_axis[1] + d[2] * m.cone_axis[2] >= m.cone_cutoff * dist + m.radius)
+                continue;
+        }
+        if (run_end == m.first_index)
+            list.counts.back() += static_cast<int>(m.index_count);
+        else
+        {
+            list.counts.push_back(static_cast<int>(m.index_count));
+            list.offsets.push_back(reinterpret_cast<const void *>(std::size_t(m.first_index) * sizeof(std::uint32_t)));
+        }
+        run_end = std::size_t(m.first_index) + m.index_count;
+        list.triangles += m.index_count / 3;
+        ++list.meshlets;
+    }
+}
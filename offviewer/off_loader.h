@@ -0,0 +1,331 @@
+#pragma once
+
+// OFF mesh loading.
+//
+// LoadOFF() memory-maps the file and parses it in place with std::from_chars:
+//  - header keywords OFF, COFF, NOFF, CNOFF, STOFF, ... (ASCII only); the
+//    counts may follow on the same line
+//  - '#' comments and blank lines anywhere
+//  - one vertex per line, extra per-vertex values (normals, colors, texture
+//    coordinates) are ignored
+//  - polygons with n > 3 are fan-triangulated, trailing face colors ignored
+//  - storage is reserved from the header counts
+// The face section is split at line boundaries and parsed by several threads.
+// If faces turn out to span several lines it is re-parsed sequentially.
+//
+// LoadOFFIostream() is the original operator>> reader, kept for comparison.
+
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Mesh
+{
+    std::vector<float> vertices; // x,y,z
+    std::vector<unsigned int> indices;
+};
+
+namespace off_detail
+{
+// Cursor over a text buffer that skips whitespace and '#' comments
+struct Cursor
+{
+    const char *p;
+    const char *end;
+
+    void SkipSpace()
+    {
+        while (p < end)
+        {
+            if (*p == '#')
+            {
+                const void *nl = std::memchr(p, '\n', end - p);
+                p = nl ? static_cast<const char *>(nl) + 1 : end;
+            }
+            else if (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+                ++p;
+            else
+                break;
+        }
+    }
+
+    // skip spaces and tabs on the current line only
+    void SkipBlank()
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+    }
+
+    void SkipLine()
+    {
+        const void *nl = std::memchr(p, '\n', end - p);
+        p = nl ? static_cast<const char *>(nl) + 1 : end;
+    }
+
+    template <class T>
+    bool Read(T &value)
+    {
+        SkipSpace();
+        auto [next, ec] = std::from_chars(p, end, value);
+        if (ec != std::errc()) return false;
+        p = next;
+        return true;
+    }
+
+    // read a number that must be on the current line
+    template <class T>
+    bool ReadOnLine(T &value)
+    {
+        SkipBlank();
+        auto [next, ec] = std::from_chars(p, end, value);
+        if (ec != std::errc()) return false;
+        p = next;
+        return true;
+    }
+
+    std::string Word()
+    {
+        SkipSpace();
+        const char *start = p;
+        while (p < end && !std::isspace(static_cast<unsigned char>(*p))) ++p;
+        return std::string(start, p);
+    }
+};
+
+// Parse "n i0 i1 ... " and fan-triangulate it into out. Faces with fewer than
+// 3 vertices or out-of-range indices are counted in skipped and not emitted.
+// Returns false on malformed input.
+template <class ReadFn>
+bool ReadFace(ReadFn read, std::size_t n_vertices, std::vector<unsigned int> &out, std::size_t &skipped)
+{
+    std::uint32_t n;
+    if (!read(n)) return false;
+    const std::size_t before = out.size();
+    std::uint32_t first = 0, prev = 0, cur = 0;
+    bool valid = n >= 3;
+    for (std::uint32_t k = 0; k < n; ++k)
+    {
+        if (!read(cur)) return false;
+        if (cur >= n_vertices) valid = false;
+        if (k == 0) first = cur;
+        else if (k >= 2)
+        {
+            out.push_back(first);
+            out.push_back(prev);
+            out.push_back(cur);
+        }
+        prev = cur;
+    }
+    if (!valid)
+    {
+        out.resize(before);
+        ++skipped;
+    }
+    return true;
+}
+
+// Parse one face per line in [begin, end). Returns number of faces read.
+inline std::size_t ParseFaceLines(const char *begin, const char *end, std::size_t n_vertices,
+                                  std::vector<unsigned int> &out, std::size_t &skipped, bool &ok)
+{
+    Cursor c{begin, end};
+    std::size_t faces = 0;
+    ok = true;
+    while (true)
+    {
+        c.SkipSpace();
+        if (c.p >= c.end) break;
+        const std::size_t before = out.size();
+        if (!ReadFace([&](std::uint32_t &v) { return c.ReadOnLine(v); }, n_vertices, out, skipped))
+        {
+            out.resize(before);
+            ok = false; // face continues on the next line
+            return faces;
+        }
+        ++faces;
+        c.SkipLine(); // ignore face colors
+    }
+    return faces;
+}
+} // namespace off_detail
+
+inline bool LoadOFF(const std::string &filename, Mesh &mesh, unsigned threads = 0)
+{
+    using namespace off_detail;
+    const auto start = std::chrono::steady_clock::now();
+
+    MappedFile file(filename);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open OFF file\n";
+        return false;
+    }
+    Cursor c{file.data(), file.data() + file.size()};
+
+    // header: [ST][C][N][4][n]OFF, only the 3D ASCII variants are supported
+    const std::string header = c.Word();
+    if (header.size() < 3 || header.compare(header.size() - 3, 3, "OFF") != 0 ||
+        header.find('4') != std::string::npos || header.find('n') != std::string::npos)
+    {
+        std::cerr << "Invalid OFF file\n";
+        return false;
+    }
+    c.SkipBlank();
+    if (c.end - c.p >= 6 && std::strncmp(c.p, "BINARY", 6) == 0)
+    {
+        std::cerr << "Binary OFF is not supported\n";
+        return false;
+    }
+
+    std::size_t n_vertices, n_faces, n_edges;
+    if (!c.Read(n_vertices) || !c.Read(n_faces) || !c.Read(n_edges))
+    {
+        std::cerr << "Invalid OFF header\n";
+        return false;
+    }
+    c.SkipLine();
+
+    // vertices, one per line, extra values ignored
+    mesh.vertices.resize(n_vertices * 3);
+    for (std::size_t i = 0; i < n_vertices; ++i)
+    {
+        c.SkipSpace();
+        float *v = &mesh.vertices[3 * i];
+        if (!c.ReadOnLine(v[0]) || !c.ReadOnLine(v[1]) || !c.ReadOnLine(v[2]))
+        {
+            std::cerr << "Invalid OFF vertex " << i << "\n";
+            return false;
+        }
+        c.SkipLine();
+    }
+
+    // faces: split the rest at line boundaries and parse chunks in parallel
+    const char *faces_begin = c.p;
+    const char *faces_end = c.end;
+    const std::size_t faces_bytes = faces_end - faces_begin;
+    if (threads == 0)
+        threads = faces_bytes < (4u << 20) ? 1u : std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<const char *> bounds(threads + 1, faces_end);
+    bounds[0] = faces_begin;
+    for (unsigned t = 1; t < threads; ++t)
+    {
+        const char *p = std::max(bounds[t - 1], faces_begin + faces_bytes * t / threads);
+        if (p > faces_begin && p < faces_end && p[-1] != '\n')
+        {
+            const void *nl = std::memchr(p, '\n', faces_end - p);
+            p = nl ? static_cast<const char *>(nl) + 1 : faces_end;
+        }
+        bounds[t] = p;
+    }
+
+    std::vector<std::vector<unsigned int>> chunks(threads);
+    std::vector<std::size_t> chunk_faces(threads, 0), chunk_skipped(threads, 0);
+    std::vector<char> chunk_ok(threads, 1);
+    auto parse = [&](unsigned t)
+    {
+        chunks[t].reserve(3 * n_faces / threads + 3);
+        bool ok;
+        chunk_faces[t] = ParseFaceLines(bounds[t], bounds[t + 1], n_vertices, chunks[t], chunk_skipped[t], ok);
+        chunk_ok[t] = ok;
+    };
+    if (threads == 1)
+        parse(0);
+    else
+    {
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) workers.emplace_back(parse, t);
+        for (auto &w : workers) w.join();
+    }
+
+    std::size_t faces_read = 0, skipped = 0;
+    bool line_based = true;
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        faces_read += chunk_faces[t];
+        skipped += chunk_skipped[t];
+        line_based = line_based && chunk_ok[t];
+    }
+
+    mesh.indices.clear();
+    mesh.indices.reserve(3 * n_faces);
+    if (line_based && faces_read == n_faces)
+    {
+        for (auto &chunk : chunks)
+            mesh.indices.insert(mesh.indices.end(), chunk.begin(), chunk.end());
+    }
+    else
+    {
+        // faces are not one per line: plain token stream, no face colors
+        Cursor fc{faces_begin, faces_end};
+        skipped = 0;
+        for (std::size_t f = 0; f < n_faces; ++f)
+        {
+            if (!ReadFace([&](std::uint32_t &v) { return fc.Read(v); }, n_vertices, mesh.indices, skipped))
+            {
+                std::cerr << "Invalid OFF face " << f << "\n";
+                return false;
+            }
+        }
+    }
+    if (skipped > 0)
+        std::cerr << "skipped " << skipped << " degenerate or out-of-range faces\n";
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "parsed " << filename << " in " << seconds * 1000.0 << " ms, "
+              << (seconds > 0.0 ? file.size() / (1024.0 * 1024.0) / seconds : 0.0) << " MB/s\n";
+    return true;
+}
+
+inline bool LoadOFFIostream(const std::string &filename, Mesh &mesh)
+{
+    const auto start = std::chrono::steady_clock::now();
+    std::ifstream in(filename);
+    if (!in)
+    {
+        std::cerr << "Failed to open OFF file\n";
+        return false;
+    }
+
+    std::string header;
+    in >> header;
+    if (header != "OFF")
+    {
+        std::cerr << "Invalid OFF file\n";
+        return false;
+    }
+
+    size_t n_vertices, n_faces, n_edges;
+    in >> n_vertices >> n_faces >> n_edges;
+
+    mesh.vertices.resize(n_vertices * 3);
+    for (size_t i = 0; i < n_vertices; ++i)
+        in >> mesh.vertices[3 * i] >> mesh.vertices[3 * i + 1] >> mesh.vertices[3 * i + 2];
+
+    for (size_t i = 0; i < n_faces; ++i)
+    {
+        int n, v0, v1, v2;
+        in >> n >> v0 >> v1 >> v2;
+        if (n != 3) continue; // only triangles
+        mesh.indices.push_back(v0);
+        mesh.indices.push_back(v1);
+        mesh.indices.push_back(v2);
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    in.clear();
+    in.seekg(0, std::ios::end);
+    const double megabytes = static_cast<double>(in.tellg()) / (1024.0 * 1024.0);
+    std::cout << "parsed " << filename << " (iostream) in " << seconds * 1000.0 << " ms, "
+              << (seconds > 0.0 ? megabytes / seconds : 0.0) << " MB/s\n";
+    return true;
+}
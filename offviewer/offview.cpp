@@ -8,54 +8,18 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#include <fstream>
-#include <sstream>
+#include "off_loader.h"
+#include "mesh_cache.h"
+#include "meshlets.h"
+#include "mesh_optimize.h"
+#include "mesh_lod.h"
+
 #include <iostream>
 #include <vector>
 #include <string>
-
-struct Mesh
-{
-    std::vector<float> vertices; // x,y,z
-    std::vector<unsigned int> indices;
-};
-
-bool LoadOFF(const std::string &filename, Mesh &mesh)
-{
-    std::ifstream in(filename);
-    if (!in)
-    {
-        std::cerr << "Failed to open OFF file\n";
-        return false;
-    }
-
-    std::string header;
-    in >> header;
-    if (header != "OFF")
-    {
-        std::cerr << "Invalid OFF file\n";
-        return false;
-    }
-
-    size_t n_vertices, n_faces, n_edges;
-    in >> n_vertices >> n_faces >> n_edges;
-
-    mesh.vertices.resize(n_vertices * 3);
-    for (size_t i = 0; i < n_vertices; ++i)
-        in >> mesh.vertices[3 * i] >> mesh.vertices[3 * i + 1] >> mesh.vertices[3 * i + 2];
-
-    for (size_t i = 0; i < n_faces; ++i)
-    {
-        int n, v0, v1, v2;
-        in >> n >> v0 >> v1 >> v2;
-        if (n != 3) continue; // only triangles
-        mesh.indices.push_back(v0);
-        mesh.indices.push_back(v1);
-        mesh.indices.push_back(v2);
-    }
-
-    return true;
-}
+#include <cstring>
+#include <algorithm>
+#include <chrono>
 
 GLuint createShader(GLenum type, const char *src)
 {
@@ -81,6 +45,62 @@ GLuint createProgram(const char *vs, const char *fs)
     return prog;
 }
 
+// Upload bytes into buffer (bound to target). With GL 4.4 / ARB_buffer_storage the buffer
+// gets immutable storage and the data is copied in chunks through a write mapping, straight
+// from the (usually memory-mapped) source; otherwise glBufferData.
+void UploadBuffer(GLenum target, GLuint buffer, const void *data, std::size_t bytes)
+{
+    glBindBuffer(target, buffer);
+    if (bytes > 0 && (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage))
+    {
+        // static data: one write mapping, no persistent mapping needed; dynamic storage allows the fallback
+        glBufferStorage(target, bytes, nullptr, GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT);
+        void *dst = glMapBufferRange(target, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (dst)
+        {
+            const std::size_t chunk = std::size_t(64) << 20;
+            for (std::size_t offset = 0; offset < bytes; offset += chunk)
+                std::memcpy(static_cast<char *>(dst) + offset, static_cast<const char *>(data) + offset,
+                            std::min(chunk, bytes - offset));
+        }
+        if (!dst || glUnmapBuffer(target) != GL_TRUE)
+            glBufferSubData(target, 0, bytes, data); // mapping failed or the store was lost
+        return;
+    }
+    glBufferData(target, bytes, data, GL_STATIC_DRAW);
+}
+
+// One mesh on the GPU, split into meshlets for culling
+struct GpuMesh
+{
+    GLuint vao = 0, vbo = 0, ebo = 0;
+    std::vector<Meshlet> meshlets;
+    std::size_t triangles = 0;
+};
+
+// Build meshlets over the cached triangle order (meshlet order, mesh_cache.h) and upload it as is
+GpuMesh UploadMesh(const MeshCache &mesh)
+{
+    GpuMesh gpu;
+    const auto start = std::chrono::steady_clock::now();
+    gpu.meshlets = BuildMeshlets(mesh.vertices(), mesh.vertex_count(), mesh.indices(), mesh.index_count());
+    gpu.triangles = mesh.index_count() / 3;
+    std::cout << gpu.triangles << " faces, " << gpu.meshlets.size() << " meshlets in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+              << " ms\n";
+
+    glGenVertexArrays(1, &gpu.vao);
+    glGenBuffers(1, &gpu.vbo);
+    glGenBuffers(1, &gpu.ebo);
+    glBindVertexArray(gpu.vao);
+    UploadBuffer(GL_ARRAY_BUFFER, gpu.vbo, mesh.vertices(), mesh.vertex_bytes());
+    UploadBuffer(GL_ELEMENT_ARRAY_BUFFER, gpu.ebo, mesh.indices(), mesh.index_bytes());
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    return gpu;
+}
+
 const char *vertexShaderSrc = R"(
 #version 330 core
 layout (location = 0) in vec3 aPos;
@@ -133,8 +153,23 @@ void ScrollCB(GLFWwindow *window, double xoff, double yoff)
     if (distance < 0.5f) distance = 0.5f;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+    // usage: off_view [--iostream] [--no-cache] [--optimize] [--lod] [file.off]
+    std::string filename = "../bunny.off";
+    bool use_iostream = false; // original reader, for load time comparison
+    bool use_cache = true;     // read/write <file>.mcache
+    bool optimize = false;     // vertex cache / fetch reordering, stored in the cache
+    bool use_lod = false;      // simplified levels, cached as <file>.lod<percent>.mcache
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--iostream") == 0) use_iostream = true;
+        else if (std::strcmp(argv[i], "--no-cache") == 0) use_cache = false;
+        else if (std::strcmp(argv[i], "--optimize") == 0) optimize = true;
+        else if (std::strcmp(argv[i], "--lod") == 0) use_lod = true;
+        else filename = argv[i];
+    }
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -155,31 +190,46 @@ int main()
     ImGui_ImplOpenGL3_Init("#version 330");
     ImGui::StyleColorsDark();
 
-    Mesh mesh;
-    if (!LoadOFF("../bunny.off", mesh)) return -1;
-    std::cout << "loaded vertices: " << mesh.vertices.size() / 3 << " faces: " << mesh.indices.size() / 3 << "\n";
-
-    GLuint VAO, VBO, EBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    MeshCache mesh;
+    if (!mesh.Load(filename, use_cache, use_iostream)) return -1;
+    std::cout << "loaded vertices: " << mesh.vertex_count() << " faces: " << mesh.index_count() / 3 << "\n";
+    if (optimize && !(mesh.flags() & MeshCache::kOptimized))
+    {
+        mesh.Replace(OptimizeMesh(mesh.vertices(), mesh.vertex_count(), mesh.indices(), mesh.index_count()),
+                     mesh.flags() | MeshCache::kOptimized | MeshCache::kMeshletOrder);
+        if (use_cache && !mesh.Write(filename + ".mcache"))
+            std::cerr << "Could not write mesh cache\n";
+    }
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float), mesh.vertices.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
+    // levels[0] is the full mesh, then the simplified LODs (--lod)
+    std::vector<GpuMesh> levels;
+    levels.push_back(UploadMesh(mesh));
+    std::vector<std::unique_ptr<MeshLod>> lod_chain;
+    if (use_lod)
+    {
+        lod_chain = LoadLodChain(filename, mesh, {0.5, 0.25, 0.1, 0.01}, use_cache);
+        for (auto &lod : lod_chain) levels.push_back(UploadMesh(lod->mesh));
+    }
+    float radius = 0.0f;
+    for (int k = 0; k < 3; ++k)
+        radius = std::max(radius, 0.5f * (mesh.bbox_max()[k] - mesh.bbox_min()[k]));
+    radius *= std::sqrt(3.0f);
 
     GLuint program = createProgram(vertexShaderSrc, fragmentShaderSrc);
     glEnable(GL_DEPTH_TEST);
 
+    bool frustum_culling = true;
+    bool cone_culling = false; // assumes counter-clockwise front faces, enables GL back-face culling too
+    bool auto_lod = true;
+    int forced_level = 0;
+    MeshletDrawList draw_list;
+
     while (!glfwWindowShouldClose(window))
     {
         glfwPollEvents();
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
         int w, h;
         glfwGetFramebufferSize(window, &w, &h);
         glViewport(0, 0, w, h);
@@ -191,18 +241,48 @@ int main()
         glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, -distance));
         view = glm::rotate(view, glm::radians(pitch), glm::vec3(1, 0, 0));
         view = glm::rotate(view, glm::radians(yaw), glm::vec3(0, 1, 0));
-        glm::mat4 proj = glm::perspective(glm::radians(45.0f), float(w) / h, 0.01f, 100.0f);
+        const float fov_y = glm::radians(45.0f);
+        glm::mat4 proj = glm::perspective(fov_y, float(w) / h, 0.01f, 100.0f);
         glm::mat4 model = glm::mat4(1.0f);
         glm::mat4 mvp = proj * view * model;
         glUniformMatrix4fv(glGetUniformLocation(program, "MVP"), 1, GL_FALSE, glm::value_ptr(mvp));
 
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0);
+        // camera position in model space for the cone test
+        const glm::vec4 eye = glm::inverse(view * model) * glm::vec4(0, 0, 0, 1);
+        const std::size_t level = auto_lod ? SelectLod(lod_chain, radius, distance, fov_y) : std::size_t(forced_level);
+        const GpuMesh &gpu = levels[std::min(level, levels.size() - 1)];
+        CullMeshlets(gpu.meshlets, glm::value_ptr(mvp), glm::value_ptr(eye), frustum_culling, cone_culling, draw_list);
+
+        if (cone_culling) glEnable(GL_CULL_FACE);
+        else glDisable(GL_CULL_FACE);
+        glBindVertexArray(gpu.vao);
+        glMultiDrawElements(GL_TRIANGLES, draw_list.counts.data(), GL_UNSIGNED_INT, draw_list.offsets.data(),
+                            static_cast<GLsizei>(draw_list.counts.size()));
+        glDisable(GL_CULL_FACE);
+
+        ImGui::Checkbox("frustum culling", &frustum_culling);
+        ImGui::Checkbox("cone culling", &cone_culling);
+        if (levels.size() > 1)
+        {
+            ImGui::Checkbox("auto LOD", &auto_lod);
+            if (!auto_lod) ImGui::SliderInt("LOD level", &forced_level, 0, int(levels.size()) - 1);
+            ImGui::Text("LOD %zu: %.0f%% of faces", level, level == 0 ? 100.0 : lod_chain[level - 1]->face_ratio * 100.0);
+        }
+        ImGui::Text("meshlets: %zu / %zu", draw_list.meshlets, gpu.meshlets.size());
+        ImGui::Text("triangles: %zu / %zu", draw_list.triangles, gpu.triangles);
+        ImGui::Text("draw ranges: %zu", draw_list.counts.size());
+        ImGui::Render();
 
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
         glfwSwapBuffers(window);
     }
 
+    for (GpuMesh &gpu : levels)
+    {
+        glDeleteVertexArrays(1, &gpu.vao);
+        glDeleteBuffers(1, &gpu.vbo);
+        glDeleteBuffers(1, &gpu.ebo);
+    }
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
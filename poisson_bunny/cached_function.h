@@ -0,0 +1,180 @@
+#pragma once
+
+// Memoizing, thread-safe wrapper around an implicit function for Mesh_3.
+//
+// The mesher evaluates the function at the same points over and over (segment
+// end points of the dichotomy searches, shared between neighboring facets).
+// Values are cached per exact query point, so the output does not change:
+//  - a small direct-mapped cache per thread catches the immediate repeats of
+//    the dichotomy without any locking (the locality "hint" layer)
+//  - a sharded hash map shared by all threads, hashed on the coordinates
+//    quantized to `quantum` so nearby queries land in the same buckets,
+//    compared exactly
+// Functions whose operator() is not thread safe (Poisson_reconstruction_function
+// without TBB keeps one mutable locate hint) are called under a lock. Copies
+// share the cache, as mesh domains copy the function they are given.
+
+#include <CGAL/number_utils.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+template <class Function>
+class CachedImplicitFunction
+{
+public:
+    typedef typename Function::FT FT;
+    typedef typename Function::Point Point;
+    typedef typename Function::Sphere Sphere;
+
+    // quantum: bucket size of the shared table, e.g. a fraction of the point spacing
+    CachedImplicitFunction(const Function &function, double quantum, bool enabled = true,
+                           bool function_thread_safe = false, std::size_t max_entries = 1 << 24)
+        : shared_(std::make_shared<Shared>(function, quantum, enabled, function_thread_safe, max_entries)) {}
+
+    FT operator()(const Point &p) const
+    {
+        Shared &s = *shared_;
+        const Query q = {CGAL::to_double(p.x()), CGAL::to_double(p.y()), CGAL::to_double(p.z())};
+        if (!s.enabled) return s.Call(p);
+
+        // per-thread cache, reset when it was filled for another function
+        thread_local LocalCache local;
+        if (local.owner != s.id)
+        {
+            local.owner = s.id;
+            for (auto &e : local.entries) e.valid = false;
+        }
+        const std::size_t h = s.Hash(q);
+        LocalEntry &slot = local.entries[h % local.entries.size()];
+        if (slot.valid && slot.query == q)
+        {
+            ++s.local_hits;
+            return FT(slot.value);
+        }
+
+        Shard &shard = *s.shards[(h >> 8) % s.shards.size()];
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.values.find(q);
+            if (it != shard.values.end())
+            {
+                ++s.shared_hits;
+                slot = {q, it->second, true};
+                return FT(it->second);
+            }
+        }
+
+        const double value = CGAL::to_double(s.Call(p));
+        ++s.misses;
+        slot = {q, value, true};
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (shard.values.size() >= s.max_entries_per_shard) shard.values.clear(); // bounded memory
+            shard.values.emplace(q, value);
+        }
+        return FT(value);
+    }
+
+    Sphere bounding_sphere() const { return shared_->function.bounding_sphere(); }
+
+    std::uint64_t local_hits() const { return shared_->local_hits; }
+    std::uint64_t shared_hits() const { return shared_->shared_hits; }
+    std::uint64_t misses() const { return shared_->misses; }
+    double hit_rate() const
+    {
+        const double hits = double(local_hits() + shared_hits());
+        const double total = hits + double(misses());
+        return total > 0.0 ? hits / total : 0.0;
+    }
+
+private:
+    struct Query
+    {
+        double x, y, z;
+        bool operator==(const Query &o) const { return x == o.x && y == o.y && z == o.z; }
+    };
+
+    struct LocalEntry
+    {
+        Query query;
+        double value;
+        bool valid;
+    };
+
+    struct LocalCache
+    {
+        std::uint64_t owner = 0;
+        std::array<LocalEntry, 64> entries{};
+    };
+
+    struct Shared;
+
+    // Hash of the quantized coordinates; equal queries quantize equally
+    struct QuantizedHash
+    {
+        const Shared *shared;
+        std::size_t operator()(const Query &q) const { return shared->Hash(q); }
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::unordered_map<Query, double, QuantizedHash> values;
+        explicit Shard(const Shared *s) : values(16, QuantizedHash{s}) {}
+    };
+
+    struct Shared
+    {
+        Shared(const Function &f, double q, bool e, bool thread_safe, std::size_t max_entries)
+            : function(f), inv_quantum(q > 0.0 ? 1.0 / q : 1.0), enabled(e), function_thread_safe(thread_safe),
+              id(NextId())
+        {
+            for (int k = 0; k < 64; ++k) shards.emplace_back(std::make_unique<Shard>(this));
+            max_entries_per_shard = std::max<std::size_t>(max_entries / shards.size(), 1);
+        }
+
+        static std::uint64_t NextId()
+        {
+            static std::atomic<std::uint64_t> next(1);
+            return next++;
+        }
+
+        std::size_t Hash(const Query &q) const
+        {
+            const std::int64_t i = std::int64_t(std::floor(q.x * inv_quantum));
+            const std::int64_t j = std::int64_t(std::floor(q.y * inv_quantum));
+            const std::int64_t k = std::int64_t(std::floor(q.z * inv_quantum));
+            std::uint64_t h = std::uint64_t(i) * 0x9E3779B97F4A7C15ull;
+            h ^= std::uint64_t(j) * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+            h ^= std::uint64_t(k) * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+            return static_cast<std::size_t>(h ^ (h >> 29));
+        }
+
+        FT Call(const Point &p)
+        {
+            if (function_thread_safe) return function(p);
+            std::lock_guard<std::mutex> lock(call_mutex);
+            return function(p);
+        }
+
+        const Function &function;
+        double inv_quantum;
+        bool enabled;
+        bool function_thread_safe;
+        std::uint64_t id;
+        std::size_t max_entries_per_shard = 0;
+        std::vector<std::unique_ptr<Shard>> shards;
+        std::mutex call_mutex;
+        std::atomic<std::uint64_t> local_hits{0}, shared_hits{0}, misses{0};
+    };
+
+    std::shared_ptr<Shared> shared_;
+};
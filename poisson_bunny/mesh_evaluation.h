@@ -0,0 +1,168 @@
+#pragma once
+
+// Approximation error of a reconstructed mesh against its input points.
+//
+// An AABB tree over the mesh triangles and a kd-tree over the input points are
+// built once, then
+//  - points -> mesh: distance of every input point to the surface
+//  - mesh -> points: distance of points sampled uniformly (by area) on the
+//    surface to the nearest input point, which catches surface that is not
+//    backed by any data (e.g. Poisson closing holes)
+// both computed in parallel. Each direction reports max, mean, RMS and the
+// 95th / 99th percentiles (nearest rank); the larger of the two maxima is the
+// Hausdorff distance. Samples come from a hash of their number, so results do
+// not depend on the thread count.
+
+#include "parallel_for.h"
+#include "stage_report.h"
+
+#include <CGAL/AABB_face_graph_triangle_primitive.h>
+#include <CGAL/AABB_traits_3.h>
+#include <CGAL/AABB_tree.h>
+#include <CGAL/Orthogonal_k_neighbor_search.h>
+#include <CGAL/Search_traits_3.h>
+#include <CGAL/Surface_mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+struct DistanceStats
+{
+    std::size_t count = 0;
+    double max = 0, mean = 0, rms = 0, p95 = 0, p99 = 0;
+
+    // Summary of distances (reordered in place)
+    static DistanceStats From(std::vector<double> &distances)
+    {
+        DistanceStats s;
+        s.count = distances.size();
+        if (distances.empty()) return s;
+        double sum = 0, sum2 = 0;
+        for (double d : distances)
+        {
+            s.max = std::max(s.max, d);
+            sum += d;
+            sum2 += d * d;
+        }
+        s.mean = sum / double(s.count);
+        s.rms = std::sqrt(sum2 / double(s.count));
+        s.p95 = Percentile(distances, 0.95);
+        s.p99 = Percentile(distances, 0.99);
+        return s;
+    }
+
+    JsonObject Json() const
+    {
+        JsonObject json;
+        json.Add("count", count).Add("max", max).Add("mean", mean).Add("rms", rms).Add("p95", p95).Add("p99", p99);
+        return json;
+    }
+
+private:
+    static double Percentile(std::vector<double> &values, double q)
+    {
+        // nearest rank: the smallest value with at least q of the values at or below it
+        const double rank = std::ceil(q * double(values.size()));
+        const std::size_t k = std::min(values.size() - 1, static_cast<std::size_t>(std::max(rank, 1.0)) - 1);
+        std::nth_element(values.begin(), values.begin() + k, values.end());
+        return values[k];
+    }
+};
+
+template <class Kernel>
+class MeshEvaluator
+{
+public:
+    typedef typename Kernel::Point_3 Point;
+    typedef CGAL::Surface_mesh<Point> Mesh;
+
+    // mesh and points must outlive the evaluator; threads as ParallelFor (0 = all cores)
+    MeshEvaluator(const Mesh &mesh, const std::vector<Point> &points, unsigned threads = 0)
+        : mesh_(mesh), points_(points), threads_(threads), tree_(faces(mesh_).first, faces(mesh_).second, mesh_),
+          search_tree_(points_.begin(), points_.end())
+    {
+        // build now: the lazy builds on the first query are not thread safe
+        tree_.build();
+        tree_.accelerate_distance_queries();
+        search_tree_.build();
+    }
+
+    DistanceStats PointsToMesh() const
+    {
+        std::vector<double> distances(points_.size());
+        ParallelFor(points_.size(), threads_, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+                distances[i] = std::sqrt(CGAL::to_double(tree_.squared_distance(points_[i])));
+        });
+        return DistanceStats::From(distances);
+    }
+
+    // samples points on the surface, measured against the nearest input point
+    DistanceStats MeshToPoints(std::size_t samples) const
+    {
+        // cumulative face areas, for area-uniform sampling
+        std::vector<typename Mesh::Face_index> face_list(faces(mesh_).first, faces(mesh_).second);
+        std::vector<double> cumulative(face_list.size());
+        double area = 0;
+        for (std::size_t f = 0; f < face_list.size(); ++f)
+        {
+            const auto h = mesh_.halfedge(face_list[f]);
+            area += std::sqrt(CGAL::to_double(CGAL::squared_area(mesh_.point(mesh_.source(h)),
+                                                                 mesh_.point(mesh_.target(h)),
+                                                                 mesh_.point(mesh_.target(mesh_.next(h))))));
+            cumulative[f] = area;
+        }
+        if (face_list.empty() || points_.empty() || area <= 0) samples = 0;
+
+        std::vector<double> distances(samples);
+        ParallelFor(samples, threads_, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                std::uint64_t state = i;
+                const double pick = Uniform(state) * area;
+                const std::size_t f = std::min<std::size_t>(
+                    std::upper_bound(cumulative.begin(), cumulative.end(), pick) - cumulative.begin(),
+                    face_list.size() - 1);
+                double u = Uniform(state), v = Uniform(state);
+                if (u + v > 1)
+                {
+                    u = 1 - u;
+                    v = 1 - v;
+                }
+                const auto h = mesh_.halfedge(face_list[f]);
+                const Point &a = mesh_.point(mesh_.source(h));
+                const Point &b = mesh_.point(mesh_.target(h));
+                const Point &c = mesh_.point(mesh_.target(mesh_.next(h)));
+                const Point p = a + u * (b - a) + v * (c - a);
+                Search search(search_tree_, p, 1);
+                distances[i] = std::sqrt(CGAL::to_double(search.begin()->second));
+            }
+        });
+        return DistanceStats::From(distances);
+    }
+
+private:
+    // splitmix64: independent uniform numbers in [0, 1) from the sample number
+    static double Uniform(std::uint64_t &state)
+    {
+        std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z ^= z >> 31;
+        return double(z >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    typedef CGAL::AABB_face_graph_triangle_primitive<Mesh> Primitive;
+    typedef CGAL::AABB_traits_3<Kernel, Primitive> Traits;
+    typedef CGAL::Orthogonal_k_neighbor_search<CGAL::Search_traits_3<Kernel>> Search;
+
+    const Mesh &mesh_;
+    const std::vector<Point> &points_;
+    unsigned threads_;
+    CGAL::AABB_tree<Traits> tree_;
+    typename Search::Tree search_tree_;
+};
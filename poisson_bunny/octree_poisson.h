@@ -0,0 +1,621 @@
+#pragma once
+
+// Poisson indicator function on an adaptive octree, solved with multigrid.
+//
+// The domain is a cube around the points (1.5x their bounding box). Levels
+// 0..dense_depth are full grids of 2^level cells per axis; the levels above
+// only keep the cells within `band` cells of a sample, so the finest cells
+// follow the surface. On every level the oriented normals are splatted
+// (trilinear hat, on the staggered face grid) into a vector field V and
+// lap(chi) = div V is discretized with the 7-point stencil on cell centers.
+//  - dense levels: V-cycles with red-black Gauss-Seidel smoothing (parallel over
+//    z slabs), full weighting restriction, trilinear prolongation, chi = 0 on
+//    the domain boundary
+//  - band levels, coarse to fine: the band starts from and is bounded
+//    (Dirichlet) by the next coarser level and is solved with parallel
+//    conjugate gradients
+// operator() interpolates the finest level that holds the point (coarser
+// levels outside the band) and is shifted so that the median over the samples
+// is 0: negative inside, positive outside. It mirrors the operator() /
+// bounding_sphere() interface of Poisson_reconstruction_function, so it plugs
+// into Poisson_mesh_domain_3 as is. Evaluation is read-only and thread safe.
+
+#include "parallel_for.h"
+
+#include <CGAL/number_utils.h>
+#include <CGAL/property_map.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+struct OctreePoissonParams
+{
+    int depth = 8;            // finest level, 2^depth cells across the domain
+    int dense_depth = 6;      // levels up to here cover the whole domain
+    int band = 2;             // cells kept around the samples on the finer levels
+    int max_cycles = 30;      // V-cycles on the finest dense level
+    int cg_iterations = 200;  // per band level
+    double tolerance = 1e-6;  // relative residual
+    unsigned threads = 0;     // 0 = hardware_concurrency
+};
+
+template <class Kernel>
+class OctreePoissonFunction
+{
+public:
+    typedef typename Kernel::FT FT;
+    typedef typename Kernel::Point_3 Point;
+    typedef typename Kernel::Vector_3 Vector;
+    typedef typename Kernel::Sphere_3 Sphere;
+
+    template <class InputIterator, class PointMap, class NormalMap>
+    OctreePoissonFunction(InputIterator first, InputIterator beyond, PointMap point_map, NormalMap normal_map,
+                          const OctreePoissonParams &params = OctreePoissonParams())
+        : params_(params)
+    {
+        for (InputIterator it = first; it != beyond; ++it)
+        {
+            const Point &p = get(point_map, *it);
+            const Vector &n = get(normal_map, *it);
+            const double len = std::sqrt(CGAL::to_double(n.squared_length()));
+            if (len == 0.0) continue;
+            samples_.push_back({{CGAL::to_double(p.x()), CGAL::to_double(p.y()), CGAL::to_double(p.z())},
+                                {CGAL::to_double(n.x()) / len, CGAL::to_double(n.y()) / len,
+                                 CGAL::to_double(n.z()) / len}});
+        }
+        params_.depth = std::max(1, std::min(params_.depth, 20));
+        params_.dense_depth = std::max(1, std::min(params_.dense_depth, params_.depth));
+
+        double lo[3] = {HUGE_VAL, HUGE_VAL, HUGE_VAL}, hi[3] = {-HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+        for (const Sample &s : samples_)
+            for (int d = 0; d < 3; ++d)
+            {
+                lo[d] = std::min(lo[d], s.p[d]);
+                hi[d] = std::max(hi[d], s.p[d]);
+            }
+        if (samples_.empty()) std::fill(lo, lo + 3, 0.0), std::fill(hi, hi + 3, 0.0);
+        double extent = 0.0, r2 = 0.0;
+        for (int d = 0; d < 3; ++d)
+        {
+            center_[d] = 0.5 * (lo[d] + hi[d]);
+            extent = std::max(extent, hi[d] - lo[d]);
+            r2 += 0.25 * (hi[d] - lo[d]) * (hi[d] - lo[d]);
+        }
+        radius_ = std::sqrt(r2);
+        size_ = std::max(1.5 * extent, 1e-12);
+        for (int d = 0; d < 3; ++d) origin_[d] = center_[d] - 0.5 * size_;
+    }
+
+    // Build the octree and solve; false without usable samples
+    bool compute_implicit_function()
+    {
+        if (samples_.empty()) return false;
+        const auto start = std::chrono::steady_clock::now();
+        levels_.clear();
+        levels_.resize(params_.depth + 1);
+        for (int l = 0; l <= params_.depth; ++l)
+        {
+            Level &level = levels_[l];
+            level.n = std::int64_t(1) << l;
+            level.dense = l <= params_.dense_depth;
+            if (level.dense)
+                level.x.assign(level.n * level.n * level.n, 0.0);
+            else
+                BuildBand(level);
+        }
+        Level &top = levels_[params_.dense_depth];
+        BucketSamples(top);
+        ComputeRhs(top);
+        SolveDense();
+        for (int l = params_.dense_depth + 1; l <= params_.depth; ++l)
+        {
+            BucketSamples(levels_[l]);
+            ComputeRhs(levels_[l]);
+            SolveBand(l);
+        }
+
+        // iso level: median over the samples
+        std::vector<double> values(samples_.size());
+        ParallelFor(samples_.size(), params_.threads, [&](std::size_t b, std::size_t e)
+        {
+            for (std::size_t s = b; s < e; ++s) values[s] = Evaluate(samples_[s].p, params_.depth);
+        });
+        std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+        iso_ = values[values.size() / 2];
+
+        std::size_t cells = 0;
+        for (const Level &level : levels_) cells += level.x.size();
+        std::cout << "octree poisson: depth " << params_.depth << " (dense " << params_.dense_depth << "), " << cells
+                  << " cells, "
+                  << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s"
+                  << std::endl;
+        return true;
+    }
+
+    FT operator()(const Point &p) const
+    {
+        const double q[3] = {CGAL::to_double(p.x()), CGAL::to_double(p.y()), CGAL::to_double(p.z())};
+        return FT(Evaluate(q, params_.depth) - iso_);
+    }
+
+    // Bounding sphere of the input points
+    Sphere bounding_sphere() const
+    {
+        return Sphere(Point(center_[0], center_[1], center_[2]), radius_ * radius_);
+    }
+
+    std::size_t cell_count(int level) const { return levels_[level].x.size(); }
+
+private:
+    struct Sample
+    {
+        double p[3];
+        double n[3];
+    };
+
+    struct Level
+    {
+        std::int64_t n = 1; // cells per axis
+        bool dense = true;
+        std::vector<double> x, b;
+        // band levels: cell keys (sorted), key -> cell, 6 neighbors per cell
+        // (>= 0: cell, < 0: ghost -(g + 1) holding the coarser solution)
+        std::vector<std::uint64_t> keys;
+        std::unordered_map<std::uint64_t, std::uint32_t> index;
+        std::vector<std::int64_t> neighbors;
+        std::vector<double> ghosts;
+        // samples per cell (CSR)
+        std::vector<std::uint32_t> sample_offsets;
+        std::vector<std::uint32_t> sample_order;
+    };
+
+    static std::uint64_t Key(std::int64_t i, std::int64_t j, std::int64_t k)
+    {
+        return std::uint64_t(i) | std::uint64_t(j) << 21 | std::uint64_t(k) << 42;
+    }
+
+    static double Hat(double t) { return std::max(0.0, 1.0 - std::abs(t)); }
+
+    // Cell containing a point, in cell units of a level with n cells per axis
+    void CellCoords(const double p[3], std::int64_t n, double t[3]) const
+    {
+        for (int d = 0; d < 3; ++d) t[d] = (p[d] - origin_[d]) / size_ * double(n);
+    }
+
+    // -1 if the cell is outside the domain or not stored
+    std::int64_t Find(const Level &level, std::int64_t i, std::int64_t j, std::int64_t k) const
+    {
+        if (i < 0 || j < 0 || k < 0 || i >= level.n || j >= level.n || k >= level.n) return -1;
+        if (level.dense) return (k * level.n + j) * level.n + i;
+        auto it = level.index.find(Key(i, j, k));
+        return it == level.index.end() ? -1 : std::int64_t(it->second);
+    }
+
+    void CellOf(const Level &level, std::size_t c, std::int64_t &i, std::int64_t &j, std::int64_t &k) const
+    {
+        if (level.dense)
+        {
+            i = std::int64_t(c) % level.n;
+            j = std::int64_t(c) / level.n % level.n;
+            k = std::int64_t(c) / (level.n * level.n);
+            return;
+        }
+        const std::uint64_t key = level.keys[c];
+        i = key & 0x1fffff;
+        j = key >> 21 & 0x1fffff;
+        k = key >> 42 & 0x1fffff;
+    }
+
+    // Cells within band of a sample cell, with their neighbor lists
+    void BuildBand(Level &level)
+    {
+        std::vector<std::uint64_t> sample_cells(samples_.size());
+        for (std::size_t s = 0; s < samples_.size(); ++s)
+        {
+            double t[3];
+            CellCoords(samples_[s].p, level.n, t);
+            sample_cells[s] = Key(std::min<std::int64_t>(std::int64_t(t[0]), level.n - 1),
+                                  std::min<std::int64_t>(std::int64_t(t[1]), level.n - 1),
+                                  std::min<std::int64_t>(std::int64_t(t[2]), level.n - 1));
+        }
+        std::sort(sample_cells.begin(), sample_cells.end());
+        sample_cells.erase(std::unique(sample_cells.begin(), sample_cells.end()), sample_cells.end());
+
+        const int b = params_.band;
+        std::vector<std::uint64_t> &keys = level.keys;
+        keys.clear();
+        keys.reserve(sample_cells.size() * 8);
+        for (std::uint64_t key : sample_cells)
+        {
+            const std::int64_t i = key & 0x1fffff, j = key >> 21 & 0x1fffff, k = key >> 42 & 0x1fffff;
+            for (std::int64_t dk = -b; dk <= b; ++dk)
+                for (std::int64_t dj = -b; dj <= b; ++dj)
+                    for (std::int64_t di = -b; di <= b; ++di)
+                    {
+                        const std::int64_t ci = i + di, cj = j + dj, ck = k + dk;
+                        if (ci < 0 || cj < 0 || ck < 0 || ci >= level.n || cj >= level.n || ck >= level.n) continue;
+                        keys.push_back(Key(ci, cj, ck));
+                    }
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        level.index.reserve(keys.size());
+        for (std::size_t c = 0; c < keys.size(); ++c) level.index.emplace(keys[c], static_cast<std::uint32_t>(c));
+        level.x.assign(keys.size(), 0.0);
+
+        level.neighbors.assign(6 * keys.size(), 0);
+        static const int offsets[6][3] = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+        std::int64_t ghosts = 0;
+        for (std::size_t c = 0; c < keys.size(); ++c)
+        {
+            std::int64_t i, j, k;
+            CellOf(level, c, i, j, k);
+            for (int a = 0; a < 6; ++a)
+            {
+                const std::int64_t nb = Find(level, i + offsets[a][0], j + offsets[a][1], k + offsets[a][2]);
+                level.neighbors[6 * c + a] = nb >= 0 ? nb : -(++ghosts);
+            }
+        }
+        level.ghosts.assign(ghosts, 0.0);
+    }
+
+    // Samples grouped by the cell that contains them
+    void BucketSamples(Level &level)
+    {
+        const std::size_t cells = level.x.size();
+        std::vector<std::uint32_t> cell_of(samples_.size());
+        level.sample_offsets.assign(cells + 1, 0);
+        for (std::size_t s = 0; s < samples_.size(); ++s)
+        {
+            double t[3];
+            CellCoords(samples_[s].p, level.n, t);
+            const std::int64_t c = Find(level, std::min<std::int64_t>(std::int64_t(t[0]), level.n - 1),
+                                        std::min<std::int64_t>(std::int64_t(t[1]), level.n - 1),
+                                        std::min<std::int64_t>(std::int64_t(t[2]), level.n - 1));
+            cell_of[s] = static_cast<std::uint32_t>(c);
+            ++level.sample_offsets[c + 1];
+        }
+        for (std::size_t c = 0; c < cells; ++c) level.sample_offsets[c + 1] += level.sample_offsets[c];
+        level.sample_order.resize(samples_.size());
+        std::vector<std::uint32_t> fill(level.sample_offsets.begin(), level.sample_offsets.end() - 1);
+        for (std::size_t s = 0; s < samples_.size(); ++s)
+            level.sample_order[fill[cell_of[s]]++] = static_cast<std::uint32_t>(s);
+    }
+
+    // b = h^2 div V per cell, gathered from the samples in the 27 surrounding cells.
+    // V = sum of n_s hat((x - s) / h) / h^3 * w with w = size^2 / #samples, which keeps
+    // the levels consistent with each other and chi of order 1.
+    void ComputeRhs(Level &level)
+    {
+        const std::size_t cells = level.x.size();
+        level.b.assign(cells, 0.0);
+        const double scale = double(level.n) * double(level.n) / double(samples_.size());
+        ParallelFor(cells, params_.threads, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t c = begin; c < end; ++c)
+            {
+                std::int64_t i, j, k;
+                CellOf(level, c, i, j, k);
+                const double center[3] = {i + 0.5, j + 0.5, k + 0.5};
+                double div = 0.0;
+                for (std::int64_t dk = -1; dk <= 1; ++dk)
+                    for (std::int64_t dj = -1; dj <= 1; ++dj)
+                        for (std::int64_t di = -1; di <= 1; ++di)
+                        {
+                            const std::int64_t nb = Find(level, i + di, j + dj, k + dk);
+                            if (nb < 0) continue;
+                            for (std::uint32_t a = level.sample_offsets[nb]; a < level.sample_offsets[nb + 1]; ++a)
+                            {
+                                const Sample &s = samples_[level.sample_order[a]];
+                                double t[3];
+                                CellCoords(s.p, level.n, t);
+                                const double w[3] = {Hat(t[0] - center[0]), Hat(t[1] - center[1]), Hat(t[2] - center[2])};
+                                // flux through the upper minus the lower face, per axis
+                                for (int d = 0; d < 3; ++d)
+                                {
+                                    const double lower = center[d] - 0.5;
+                                    const double across = w[(d + 1) % 3] * w[(d + 2) % 3];
+                                    div += s.n[d] * across * (Hat(t[d] - lower - 1.0) - Hat(t[d] - lower));
+                                }
+                            }
+                        }
+                level.b[c] = div * scale;
+            }
+        });
+    }
+
+    // Dense level value at cell-center coordinates t (cell c has its center at c), 0 outside
+    double SampleDense(const Level &level, const double t[3]) const
+    {
+        const std::int64_t i0 = std::int64_t(std::floor(t[0])), j0 = std::int64_t(std::floor(t[1])),
+                           k0 = std::int64_t(std::floor(t[2]));
+        const double f[3] = {t[0] - i0, t[1] - j0, t[2] - k0};
+        double value = 0.0;
+        for (int c = 0; c < 8; ++c)
+        {
+            const std::int64_t idx = Find(level, i0 + (c & 1), j0 + (c >> 1 & 1), k0 + (c >> 2 & 1));
+            if (idx < 0) continue;
+            const double weight = ((c & 1) ? f[0] : 1.0 - f[0]) * ((c >> 1 & 1) ? f[1] : 1.0 - f[1]) *
+                                  ((c >> 2 & 1) ? f[2] : 1.0 - f[2]);
+            value += weight * level.x[idx];
+        }
+        return value;
+    }
+
+    // chi at p from level l, falling back to coarser levels outside the band
+    double Evaluate(const double p[3], int l) const
+    {
+        const Level &level = levels_[l];
+        double t[3];
+        CellCoords(p, level.n, t);
+        for (int d = 0; d < 3; ++d)
+            if (t[d] < 0.0 || t[d] > double(level.n)) return 0.0; // boundary value
+        for (int d = 0; d < 3; ++d) t[d] -= 0.5;
+        if (level.dense) return SampleDense(level, t);
+
+        const std::int64_t ci = std::min<std::int64_t>(std::int64_t(std::floor(t[0] + 0.5)), level.n - 1);
+        const std::int64_t cj = std::min<std::int64_t>(std::int64_t(std::floor(t[1] + 0.5)), level.n - 1);
+        const std::int64_t ck = std::min<std::int64_t>(std::int64_t(std::floor(t[2] + 0.5)), level.n - 1);
+        if (Find(level, ci, cj, ck) < 0) return Evaluate(p, l - 1);
+
+        const std::int64_t i0 = std::int64_t(std::floor(t[0])), j0 = std::int64_t(std::floor(t[1])),
+                           k0 = std::int64_t(std::floor(t[2]));
+        const double f[3] = {t[0] - i0, t[1] - j0, t[2] - k0};
+        double value = 0.0;
+        for (int c = 0; c < 8; ++c)
+        {
+            const std::int64_t i = i0 + (c & 1), j = j0 + (c >> 1 & 1), k = k0 + (c >> 2 & 1);
+            const double weight = ((c & 1) ? f[0] : 1.0 - f[0]) * ((c >> 1 & 1) ? f[1] : 1.0 - f[1]) *
+                                  ((c >> 2 & 1) ? f[2] : 1.0 - f[2]);
+            if (weight == 0.0) continue;
+            const std::int64_t idx = Find(level, i, j, k);
+            value += weight * (idx >= 0 ? level.x[idx] : CellValueFromCoarser(l, i, j, k));
+        }
+        return value;
+    }
+
+    // Value of a (missing) cell of level l from the coarser levels
+    double CellValueFromCoarser(int l, std::int64_t i, std::int64_t j, std::int64_t k) const
+    {
+        const double h = size_ / double(levels_[l].n);
+        const double p[3] = {origin_[0] + (i + 0.5) * h, origin_[1] + (j + 0.5) * h, origin_[2] + (k + 0.5) * h};
+        return Evaluate(p, l - 1);
+    }
+
+    // Red-black Gauss-Seidel on a dense level, parallel over z slabs
+    void Smooth(Level &level, int sweeps)
+    {
+        const std::int64_t n = level.n;
+        for (int sweep = 0; sweep < sweeps; ++sweep)
+            for (int color = 0; color < 2; ++color)
+                ParallelFor(n, params_.threads, [&](std::size_t k_begin, std::size_t k_end)
+                {
+                    for (std::int64_t k = k_begin; k < std::int64_t(k_end); ++k)
+                        for (std::int64_t j = 0; j < n; ++j)
+                            for (std::int64_t i = (j + k + color) & 1; i < n; i += 2)
+                            {
+                                const std::int64_t c = (k * n + j) * n + i;
+                                double sum = 0.0;
+                                if (i > 0) sum += level.x[c - 1];
+                                if (i + 1 < n) sum += level.x[c + 1];
+                                if (j > 0) sum += level.x[c - n];
+                                if (j + 1 < n) sum += level.x[c + n];
+                                if (k > 0) sum += level.x[c - n * n];
+                                if (k + 1 < n) sum += level.x[c + n * n];
+                                level.x[c] = (sum - level.b[c]) / 6.0;
+                            }
+                }, 1);
+    }
+
+    // r = b - A x on a dense level; returns |r|^2
+    double Residual(const Level &level, std::vector<double> &r) const
+    {
+        const std::int64_t n = level.n;
+        r.resize(level.x.size());
+        std::vector<double> partial(n, 0.0);
+        ParallelFor(n, params_.threads, [&](std::size_t k_begin, std::size_t k_end)
+        {
+            for (std::int64_t k = k_begin; k < std::int64_t(k_end); ++k)
+            {
+                double norm = 0.0;
+                for (std::int64_t j = 0; j < n; ++j)
+                    for (std::int64_t i = 0; i < n; ++i)
+                    {
+                        const std::int64_t c = (k * n + j) * n + i;
+                        double ax = -6.0 * level.x[c];
+                        if (i > 0) ax += level.x[c - 1];
+                        if (i + 1 < n) ax += level.x[c + 1];
+                        if (j > 0) ax += level.x[c - n];
+                        if (j + 1 < n) ax += level.x[c + n];
+                        if (k > 0) ax += level.x[c - n * n];
+                        if (k + 1 < n) ax += level.x[c + n * n];
+                        r[c] = level.b[c] - ax;
+                        norm += r[c] * r[c];
+                    }
+                partial[k] = norm;
+            }
+        }, 1);
+        double norm = 0.0;
+        for (double p : partial) norm += p;
+        return norm;
+    }
+
+    void VCycle(int l, int coarsest)
+    {
+        Level &level = levels_[l];
+        if (l == coarsest)
+        {
+            Smooth(level, 50);
+            return;
+        }
+        Smooth(level, 2);
+        std::vector<double> r;
+        Residual(level, r);
+
+        // full weighting to the coarser level; h^2 scaling of the system gives the factor 4
+        Level &coarse = levels_[l - 1];
+        const std::int64_t n = level.n, m = coarse.n;
+        coarse.b.assign(coarse.x.size(), 0.0);
+        std::fill(coarse.x.begin(), coarse.x.end(), 0.0);
+        ParallelFor(m, params_.threads, [&](std::size_t k_begin, std::size_t k_end)
+        {
+            for (std::int64_t k = k_begin; k < std::int64_t(k_end); ++k)
+                for (std::int64_t j = 0; j < m; ++j)
+                    for (std::int64_t i = 0; i < m; ++i)
+                    {
+                        double sum = 0.0;
+                        for (int c = 0; c < 8; ++c)
+                            sum += r[((2 * k + (c >> 2 & 1)) * n + 2 * j + (c >> 1 & 1)) * n + 2 * i + (c & 1)];
+                        coarse.b[(k * m + j) * m + i] = 0.5 * sum;
+                    }
+        }, 1);
+
+        VCycle(l - 1, coarsest);
+
+        // trilinear prolongation of the correction: fine center I sits at I / 2 - 0.25 on the coarse grid
+        ParallelFor(n, params_.threads, [&](std::size_t k_begin, std::size_t k_end)
+        {
+            for (std::int64_t k = k_begin; k < std::int64_t(k_end); ++k)
+                for (std::int64_t j = 0; j < n; ++j)
+                    for (std::int64_t i = 0; i < n; ++i)
+                    {
+                        const double t[3] = {0.5 * i - 0.25, 0.5 * j - 0.25, 0.5 * k - 0.25};
+                        level.x[(k * n + j) * n + i] += SampleDense(coarse, t);
+                    }
+        }, 1);
+        Smooth(level, 2);
+    }
+
+    void SolveDense()
+    {
+        Level &top = levels_[params_.dense_depth];
+        const int coarsest = std::min(2, params_.dense_depth);
+        double b_norm = 0.0;
+        for (double v : top.b) b_norm += v * v;
+        std::vector<double> r;
+        double r_norm = b_norm;
+        int cycles = 0;
+        while (cycles < params_.max_cycles && r_norm > params_.tolerance * params_.tolerance * b_norm)
+        {
+            VCycle(params_.dense_depth, coarsest);
+            r_norm = Residual(top, r);
+            ++cycles;
+        }
+        std::cout << "  dense level " << params_.dense_depth << ": " << top.x.size() << " cells, " << cycles
+                  << " V-cycles, relative residual " << std::sqrt(r_norm / std::max(b_norm, 1e-300)) << std::endl;
+    }
+
+    // Band level: start from the coarser solution, ghosts fixed to it, CG on 6 x_c - sum x_n = sum ghosts - b
+    void SolveBand(int l)
+    {
+        Level &level = levels_[l];
+        const std::size_t cells = level.x.size();
+        static const int offsets[6][3] = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+        ParallelFor(cells, params_.threads, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t c = begin; c < end; ++c)
+            {
+                std::int64_t i, j, k;
+                CellOf(level, c, i, j, k);
+                level.x[c] = CellValueFromCoarser(l, i, j, k);
+                for (int a = 0; a < 6; ++a)
+                {
+                    const std::int64_t nb = level.neighbors[6 * c + a];
+                    if (nb < 0)
+                        level.ghosts[-nb - 1] = CellValueFromCoarser(l, i + offsets[a][0], j + offsets[a][1],
+                                                                     k + offsets[a][2]);
+                }
+            }
+        });
+
+        // A x with the active neighbors only
+        auto apply = [&](const std::vector<double> &v, std::vector<double> &out)
+        {
+            ParallelFor(cells, params_.threads, [&](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t c = begin; c < end; ++c)
+                {
+                    double sum = 6.0 * v[c];
+                    for (int a = 0; a < 6; ++a)
+                    {
+                        const std::int64_t nb = level.neighbors[6 * c + a];
+                        if (nb >= 0) sum -= v[nb];
+                    }
+                    out[c] = sum;
+                }
+            });
+        };
+        // blocked sums keep the result independent of the thread count
+        const std::size_t block = 4096;
+        std::vector<double> partial((cells + block - 1) / block);
+        auto dot = [&](const std::vector<double> &u, const std::vector<double> &v)
+        {
+            ParallelFor(partial.size(), params_.threads, [&](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t p = begin; p < end; ++p)
+                {
+                    double sum = 0.0;
+                    for (std::size_t c = p * block; c < std::min(cells, (p + 1) * block); ++c) sum += u[c] * v[c];
+                    partial[p] = sum;
+                }
+            }, 1);
+            double sum = 0.0;
+            for (double p : partial) sum += p;
+            return sum;
+        };
+
+        std::vector<double> rhs(cells), r(cells), d(cells), q(cells);
+        for (std::size_t c = 0; c < cells; ++c)
+        {
+            double sum = -level.b[c];
+            for (int a = 0; a < 6; ++a)
+            {
+                const std::int64_t nb = level.neighbors[6 * c + a];
+                if (nb < 0) sum += level.ghosts[-nb - 1];
+            }
+            rhs[c] = sum;
+        }
+        apply(level.x, q);
+        for (std::size_t c = 0; c < cells; ++c) r[c] = d[c] = rhs[c] - q[c];
+        const double rhs_norm = std::max(dot(rhs, rhs), 1e-300);
+        double delta = dot(r, r);
+        int iterations = 0;
+        for (; iterations < params_.cg_iterations && delta > params_.tolerance * params_.tolerance * rhs_norm;
+             ++iterations)
+        {
+            apply(d, q);
+            const double alpha = delta / dot(d, q);
+            ParallelFor(cells, params_.threads, [&](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t c = begin; c < end; ++c)
+                {
+                    level.x[c] += alpha * d[c];
+                    r[c] -= alpha * q[c];
+                }
+            });
+            const double next = dot(r, r);
+            const double beta = next / delta;
+            delta = next;
+            ParallelFor(cells, params_.threads, [&](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t c = begin; c < end; ++c) d[c] = r[c] + beta * d[c];
+            });
+        }
+        std::cout << "  band level " << l << ": " << cells << " cells, " << iterations
+                  << " CG iterations, relative residual " << std::sqrt(delta / rhs_norm) << std::endl;
+    }
+
+    OctreePoissonParams params_;
+    std::vector<Sample> samples_;
+    std::vector<Level> levels_;
+    double origin_[3] = {0, 0, 0};
+    double center_[3] = {0, 0, 0};
+    double size_ = 1.0;   // domain cube side
+    double radius_ = 0.0; // bounding sphere of the points
+    double iso_ = 0.0;
+};
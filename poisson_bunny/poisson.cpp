@@ -1,5 +1,5 @@
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
-#include <CGAL/Polyhedron_3.h>
+#include <CGAL/Surface_mesh.h>
 #include <CGAL/Poisson_reconstruction_function.h>
 
 #include <CGAL/Mesh_triangulation_3.h>
@@ -8,23 +8,36 @@
 #include <CGAL/Poisson_mesh_domain_3.h>
 #include <CGAL/make_mesh_3.h>
 #include <CGAL/facets_in_complex_3_to_triangle_mesh.h>
-#include <CGAL/mst_orient_normals.h>
-#include <CGAL/jet_estimate_normals.h>
 
-#include <CGAL/Point_set_3.h>
-// #include <CGAL/Point_set_processing_3.h>
 #include <CGAL/edge_aware_upsample_point_set.h>
 
 #include <CGAL/property_map.h>
-#include <CGAL/IO/read_points.h>
 #include <CGAL/compute_average_spacing.h>
-
-#include <CGAL/Polygon_mesh_processing/distance.h>
-
-#include <boost/iterator/transform_iterator.hpp>
-
+#include <CGAL/Random.h>
+#include <CGAL/Search_traits_3.h>
+#include <CGAL/Orthogonal_k_neighbor_search.h>
+
+
+#ifdef CGAL_LINKED_WITH_TBB
+#include <tbb/global_control.h>
+#endif
+
+#include "cached_function.h"
+#include "mesh_evaluation.h"
+#include "normals_engine.h"
+#include "octree_poisson.h"
+#include "parallel_for.h"
+#include "point_cache.h"
+#include "poisson_options.h"
+#include "stage_report.h"
+#include "tiled_reconstruction.h"
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
 #include <vector>
 #include <fstream>
+#include <memory>
 // Types
 typedef CGAL::Exact_predicates_inexact_constructions_kernel Kernel;
 typedef Kernel::FT FT;
@@ -35,167 +48,536 @@ typedef CGAL::First_of_pair_property_map<Point_with_normal> Point_map;
 typedef CGAL::Second_of_pair_property_map<Point_with_normal> Normal_map;
 typedef Kernel::Sphere_3 Sphere;
 typedef std::vector<Point_with_normal> PointList;
-typedef CGAL::Polyhedron_3<Kernel> Polyhedron;
+typedef CGAL::Surface_mesh<Point> Surface_mesh;
 typedef CGAL::Poisson_reconstruction_function<Kernel> Poisson_reconstruction_function;
 typedef CGAL::Poisson_mesh_domain_3<Kernel> Mesh_domain;
+typedef CGAL::Search_traits_3<Kernel> Search_traits;
+typedef CGAL::Orthogonal_k_neighbor_search<Search_traits> Neighbor_search;
 typedef CGAL::Mesh_triangulation_3<Mesh_domain>::type Tr;
-typedef CGAL::Mesh_complex_3_in_triangulation_3<Tr> C3t3;
-typedef CGAL::Mesh_criteria_3<Tr> Mesh_criteria;
-
-typedef CGAL::Point_set_3<Point> Point_set;
-typedef std::pair<Point, Vector> PointVectorPair;
-
-int main(int argc, const char * argv[])
+#ifdef CGAL_LINKED_WITH_TBB
+// Concurrent refinement; the triangulation type decides which make_mesh_3 runs
+typedef CGAL::Mesh_triangulation_3<Mesh_domain, CGAL::Default, CGAL::Parallel_tag>::type Parallel_tr;
+#endif
+
+// Poisson_reconstruction_function keeps its locate hint in a tbb::enumerable_thread_specific
+// when CGAL is linked with TBB, so concurrent calls are safe; without TBB there is one shared hint
+#ifdef CGAL_LINKED_WITH_TBB
+const bool kPoissonFunctionThreadSafe = true;
+#else
+const bool kPoissonFunctionThreadSafe = false;
+#endif
+
+// Reads the point set file in points[] through the binary point cache.
+// Files with fewer than 6 values per point get zero normals.
+bool LoadPoints(const std::string &fname, PointList &points, bool &has_normals)
 {
-    float min_angle = 20.0, max_size = 0.5, rel_err = 0.1;
-    if(argc == 4)
+    PointCache cache;
+    if (!cache.Load(fname) || cache.channels() < 3)
     {
-      min_angle = atof(argv[1]);
-      max_size = atof(argv[2]); 
-      rel_err = atof(argv[3]); 
+        std::cerr << "Error: cannot read file " << fname << std::endl;
+        return false;
     }
+    has_normals = cache.channels() >= 6;
+    points.resize(cache.size());
+    for (std::size_t i = 0; i < cache.size(); ++i)
+    {
+        points[i].first = Point(cache.channel(0)[i], cache.channel(1)[i], cache.channel(2)[i]);
+        points[i].second = has_normals ? Vector(cache.channel(3)[i], cache.channel(4)[i], cache.channel(5)[i])
+                                       : Vector(0, 0, 0);
+    }
+    return true;
+}
 
-    FT sm_angle = min_angle; // Min triangle angle in degrees.
-    FT sm_radius = max_size; // Max triangle size w.r.t. point set average spacing.
-    FT sm_distance = rel_err; // Surface Approximation error w.r.t. point set average spacing.
-
-    // Reads the point set file in points[].
-    // Note: read_points() requires an iterator over points
-    // + property maps to access each point's position and normal.
-    PointList points;
-    std::string fname = "../bunny_with_normals.xyz";
-    // std::string fname = "points_3/kitten.xyz";
-    if(!CGAL::IO::read_points(CGAL::data_file_path(fname), std::back_inserter(points),
-                          CGAL::parameters::point_map(Point_map())
-                                           .normal_map (Normal_map())))
-    {
-      std::cerr << "Error: cannot read file input file!" << std::endl;
-      return EXIT_FAILURE;
-    }
-
-    // perform upsampling 
-    std::vector<Point_with_normal> upsampled;
-    const double sharpness_angle = 5;   // control sharpness of the result.
-    const double edge_sensitivity = 0.1;    // higher values will sample more points near the edges
-    const double neighbor_radius = 0.2;  // initial size of neighborhood.
-    const std::size_t number_of_output_points = points.size() * 10;
-
-    printf("START UPSAMPLING\n");
-    CGAL::edge_aware_upsample_point_set<CGAL::Parallel_if_available_tag>(
-        points,
-        std::back_inserter(upsampled),
-        CGAL::parameters::point_map(CGAL::First_of_pair_property_map<PointVectorPair>()).
-        normal_map(CGAL::Second_of_pair_property_map<PointVectorPair>()).
-        sharpness_angle(sharpness_angle).
-        edge_sensitivity(edge_sensitivity).
-        neighbor_radius(neighbor_radius).
-        number_of_output_points(number_of_output_points));
-    
-        printf("Upsampled %ld --> %ld\n",points.size(), upsampled.size());
-
-        points = std::move(upsampled);
+// Removes NaNs and zero-length normals; returns the number of removed points
+std::size_t CleanPoints(PointList &points, bool check_normals)
+{
+    const std::size_t before = points.size();
+    points.erase(
+        std::remove_if(
+            points.begin(), points.end(),
+            [&](const Point_with_normal& pn) {
+                const Point &p = pn.first;
+                const Vector &n = pn.second;
+                return std::isnan(p.x()) || std::isnan(p.y()) || std::isnan(p.z()) ||
+                       std::isnan(n.x()) || std::isnan(n.y()) || std::isnan(n.z()) ||
+                       (check_normals && n.squared_length() < 1e-12);
+            }),
+        points.end());
+    return before - points.size();
+}
 
-for (auto& pn : points) 
+OctreePoissonParams OctreeParams(const PoissonOptions &options)
 {
-    const Point& p = pn.first;
-    const Vector& n = pn.second;
-    if (n.squared_length() < 1e-12) 
-      std::cerr << "Zero-length normal detected!\n";
+    OctreePoissonParams params;
+    params.depth = static_cast<int>(options.octree_depth);
+    params.dense_depth = static_cast<int>(options.octree_dense_depth);
+    params.band = static_cast<int>(options.octree_band);
+    return params;
 }
 
-// Remove NaNs
-points.erase(
-  std::remove_if(
-    points.begin(), points.end(),
-    [](const Point_with_normal& pn) {
-            auto p = pn.first;
-            auto n = pn.second;
-            return (
-              std::isnan(p.x()) || std::isnan(p.y()) || std::isnan(p.z()) || 
-              std::isnan(n.x()) || std::isnan(n.y()) || std::isnan(n.z()) 
-            );
-        }),
-    points.end()
-);
+JsonObject ParametersJson(PoissonOptions &options)
+{
+    JsonObject parameters;
+    for (const PoissonOption &opt : PoissonOptionTable(options))
+    {
+        if (opt.number)
+            parameters.Add(opt.name, *opt.number);
+        else
+            parameters.Add(opt.name, *opt.text);
+    }
+    return parameters;
+}
 
+// Meshes the zero level of the domain function into output_mesh with the triangulation Tr_t
+template <class Tr_t>
+bool MeshSurface(const Mesh_domain &domain, const PoissonOptions &options, FT average_spacing, Surface_mesh &output_mesh)
+{
+    typedef CGAL::Mesh_complex_3_in_triangulation_3<Tr_t> C3t3_t;
 
-// Re-estimate + re-orient normals
-CGAL::jet_estimate_normals<CGAL::Sequential_tag>(
-    points, 24,
-    CGAL::parameters::point_map(Point_map()).normal_map(Normal_map())
-);
+    // Defines surface mesh generation criteria
+    CGAL::Mesh_criteria_3<Tr_t> criteria(CGAL::parameters::facet_angle = options.facet_angle,
+                                         CGAL::parameters::facet_size = options.facet_size * average_spacing,
+                                         CGAL::parameters::facet_distance = options.facet_distance * average_spacing);
 
-auto unoriented =
-    CGAL::mst_orient_normals(points, 24,
-        CGAL::parameters::point_map(Point_map()).normal_map(Normal_map()));
+    // Generates mesh with manifold option
+    C3t3_t c3t3 = CGAL::make_mesh_3<C3t3_t>(domain, criteria,
+                                            CGAL::parameters::surface_only()
+                                            .manifold_with_boundary());
 
-points.erase(unoriented, points.end());
+    if (c3t3.triangulation().number_of_vertices() == 0) return false;
+    CGAL::facets_in_complex_3_to_triangle_mesh(c3t3, output_mesh);
+    return true;
+}
 
-printf("Removed invalid points to %ld\n",points.size());
+// Meshes the zero level of function inside bsphere with threads meshing threads (1 = sequential);
+// thread count, whether function calls are serialized and cache counts go to stats
+template <class Function>
+bool MeshFunction(const Function &function, bool thread_safe, const Sphere &bsphere, FT average_spacing,
+                  const PoissonOptions &options, int threads, Surface_mesh &output_mesh, JsonObject &stats)
+{
+    FT sm_sphere_radius = 2.0 * std::sqrt(bsphere.squared_radius());
+    FT sm_dichotomy_error = options.facet_distance * average_spacing / 1000.0; // Dichotomy error must be << sm_distance
 
-    // Creates implicit function from the read points using the default solver.
+    // Defines mesh domain; the dichotomy searches revisit the same points, so their values are cached
+    CachedImplicitFunction<Function> cached(function, CGAL::to_double(sm_dichotomy_error), options.eval_cache != 0,
+                                            thread_safe);
+    Mesh_domain domain = Mesh_domain::create_Poisson_mesh_domain(cached, bsphere,
+        CGAL::parameters::relative_error_bound(sm_dichotomy_error / sm_sphere_radius));
 
-    // Note: this method requires an iterator over points
-    // + property maps to access each point's position and normal.
-    printf("START POISSON\n");
-    Poisson_reconstruction_function function(points.begin(), points.end(), Point_map(), Normal_map());
+    bool meshed = false;
+#ifdef CGAL_LINKED_WITH_TBB
+    if (threads != 1)
+    {
+        const std::size_t cores = threads > 0 ? std::size_t(threads)
+            : tbb::global_control::active_value(tbb::global_control::max_allowed_parallelism);
+        tbb::global_control limit(tbb::global_control::max_allowed_parallelism, cores);
+        stats.Add("threads", cores);
+        meshed = MeshSurface<Parallel_tr>(domain, options, average_spacing, output_mesh);
+    }
+    else
+#else
+    if (threads != 1) std::cerr << "built without TBB, meshing sequentially" << std::endl;
+#endif
+    {
+        stats.Add("threads", std::size_t(1));
+        meshed = MeshSurface<Tr>(domain, options, average_spacing, output_mesh);
+    }
+    stats.Add("function_locked", !thread_safe);
+    if (meshed && options.eval_cache != 0)
+    {
+        stats.Add("cache_local_hits", std::size_t(cached.local_hits()))
+             .Add("cache_shared_hits", std::size_t(cached.shared_hits()))
+             .Add("cache_misses", std::size_t(cached.misses()))
+             .Add("cache_hit_rate", cached.hit_rate());
+    }
+    return meshed;
+}
 
+// Solves for the implicit function (the solve stage is already running), meshes its zero level
+// and evaluates the mesh, as far as the options ask for
+template <class Function>
+int SolveAndMesh(Function &function, bool thread_safe, const PointList &points, const PoissonOptions &options,
+                 StageReport &report)
+{
     // Computes the Poisson indicator function f()
-    // at each vertex of the triangulation.
     if ( ! function.compute_implicit_function() ) return EXIT_FAILURE;
-    printf("DONE POISSON\n");
 
     // Computes average spacing
-    FT average_spacing = CGAL::compute_average_spacing<CGAL::Sequential_tag>(points, 6 /* knn = 1 ring */,CGAL::parameters::point_map (Point_map()));
-    printf("average spacing = %f\n",average_spacing);
+    FT average_spacing = CGAL::compute_average_spacing<CGAL::Parallel_if_available_tag>(
+        points, static_cast<unsigned>(options.spacing_k), CGAL::parameters::point_map(Point_map()));
 
     //Computes implicit function bounding sphere radius.
     Sphere bsphere = function.bounding_sphere();
     FT radius = std::sqrt(bsphere.squared_radius());
-    printf("bsphere-radius = %f\n",radius);
+    report.stage().Add("average_spacing", CGAL::to_double(average_spacing))
+                  .Add("bsphere_radius", CGAL::to_double(radius));
+    report.End();
 
-    FT sm_sphere_radius = 2.0 * radius;
-    FT sm_dichotomy_error = sm_distance*average_spacing/1000.0; // Dichotomy error must be << sm_distance
-    printf("dicho-error = %f\n",sm_dichotomy_error);
+    if (!options.mesh)
+    {
+        report.Skip("mesh");
+        report.Skip("evaluate");
+        return EXIT_SUCCESS;
+    }
 
-    // Defines surface mesh generation criteria
-    Mesh_criteria criteria(CGAL::parameters::facet_angle = sm_angle,
-                           CGAL::parameters::facet_size = sm_radius*average_spacing,
-                           CGAL::parameters::facet_distance = sm_distance*average_spacing);
+    report.Begin("mesh");
+    // Deterministic runs mesh sequentially from a fixed seed, so meshes can be compared across runs
+    const int threads = options.deterministic != 0 ? 1 : static_cast<int>(options.mesh_threads);
+    if (options.deterministic != 0) CGAL::get_default_random() = CGAL::Random(0);
+    Surface_mesh output_mesh;
+    if (!MeshFunction(function, thread_safe, bsphere, average_spacing, options, threads, output_mesh, report.stage()))
+        return EXIT_FAILURE;
 
-    // Defines mesh domain
-    Mesh_domain domain = Mesh_domain::create_Poisson_mesh_domain(function, bsphere,
-        CGAL::parameters::relative_error_bound(sm_dichotomy_error / sm_sphere_radius));
+    // saves reconstructed surface mesh
+    std::ofstream out(options.output);
+    out << output_mesh;
+    report.stage().Add("vertices", std::size_t(output_mesh.number_of_vertices()))
+                  .Add("facets", std::size_t(output_mesh.number_of_faces()));
+    report.End();
 
-    // Generates mesh with manifold option
-    printf("START MESHING\n");
-    C3t3 c3t3 = CGAL::make_mesh_3<C3t3>(domain, criteria,
-                                        CGAL::parameters::surface_only()
-                                        .manifold_with_boundary());
-
-    printf("DONE MESHING\n");
-    const Tr& tr = c3t3.triangulation();
-    if(tr.number_of_vertices() == 0) return EXIT_FAILURE;
-
-    /// [PMP_distance_snippet]
-    // computes the approximation error of the reconstruction
-    Polyhedron output_mesh;
-    CGAL::facets_in_complex_3_to_triangle_mesh(c3t3, output_mesh);
-    double max_dist =
-      CGAL::Polygon_mesh_processing::approximate_max_distance_to_point_set
-      (output_mesh,
-       CGAL::make_range (boost::make_transform_iterator
-                         (points.begin(), CGAL::Property_map_to_unary_function<Point_map>()),
-                         boost::make_transform_iterator
-                         (points.end(), CGAL::Property_map_to_unary_function<Point_map>())),
-       3000);
-    std::cout << "Max distance to point_set: " << max_dist << std::endl;
-    /// [PMP_distance_snippet]
+    if (!options.evaluate)
+    {
+        report.Skip("evaluate");
+        return EXIT_SUCCESS;
+    }
 
+    // approximation error of the reconstruction, both ways
+    report.Begin("evaluate").Add("points", points.size());
+    std::vector<Point> positions;
+    positions.reserve(points.size());
+    for (const auto &pn : points) positions.push_back(pn.first);
+    MeshEvaluator<Kernel> evaluator(output_mesh, positions);
+    const DistanceStats to_mesh = evaluator.PointsToMesh();
+    const DistanceStats to_points = evaluator.MeshToPoints(static_cast<std::size_t>(options.eval_samples));
+    const double hausdorff = std::max(to_mesh.max, to_points.max);
+    std::cout << "points -> mesh: max " << to_mesh.max << ", rms " << to_mesh.rms << ", p99 " << to_mesh.p99 << "\n"
+              << "mesh -> points: max " << to_points.max << ", rms " << to_points.rms << ", p99 " << to_points.p99
+              << "\nHausdorff distance: " << hausdorff << std::endl;
+
+    JsonObject evaluation;
+    evaluation.Add("mesh", options.output).Add("input", options.input)
+              .Add("points_to_mesh", to_mesh.Json()).Add("mesh_to_points", to_points.Json())
+              .Add("hausdorff", hausdorff);
+    std::ofstream eval_out(options.eval_report);
+    eval_out << evaluation.str() << "\n";
+    if (!eval_out) std::cerr << "Could not write " << options.eval_report << std::endl;
+    report.stage().Add("points_to_mesh", to_mesh.Json()).Add("mesh_to_points", to_points.Json())
+                  .Add("hausdorff", hausdorff);
+    report.End();
+    return EXIT_SUCCESS;
+}
 
-    // saves reconstructed surface mesh
-    std::ofstream out("bunny.off");
-    out << output_mesh;
+// Solves and meshes the points of one tile, sequentially (tiles run in parallel)
+template <class Function>
+bool ReconstructTile(Function &function, bool thread_safe, const PointList &points, const PoissonOptions &options,
+                     Surface_mesh &mesh, FT &average_spacing)
+{
+    if (!function.compute_implicit_function()) return false;
+    average_spacing = CGAL::compute_average_spacing<CGAL::Sequential_tag>(
+        points, static_cast<unsigned>(options.spacing_k), CGAL::parameters::point_map(Point_map()));
+    JsonObject stats;
+    return MeshFunction(function, thread_safe, function.bounding_sphere(), average_spacing, options, 1, mesh, stats);
+}
 
+// The triangles of mesh owned by tile, as an indexed piece with its border vertices flagged.
+// With max_distance > 0, triangles farther than that from every sample are dropped: the lids
+// Poisson closes open scans with.
+TilePiece ClipTile(const Surface_mesh &mesh, const TileGrid &grid, std::size_t tile, const PointList &points,
+                   double max_distance)
+{
+    std::vector<Point> samples;
+    samples.reserve(points.size());
+    for (const auto &pn : points) samples.push_back(pn.first);
+    Neighbor_search::Tree tree(samples.begin(), samples.end());
+
+    TilePiece piece;
+    const std::uint32_t unused = 0xffffffffu;
+    std::vector<std::uint32_t> local(mesh.number_of_vertices(), unused);
+    for (auto f : mesh.faces())
+    {
+        const auto h = mesh.halfedge(f);
+        const Surface_mesh::Vertex_index corners[3] = {mesh.source(h), mesh.target(h), mesh.target(mesh.next(h))};
+        const Point centroid =
+            CGAL::centroid(mesh.point(corners[0]), mesh.point(corners[1]), mesh.point(corners[2]));
+        const float center[3] = {float(centroid.x()), float(centroid.y()), float(centroid.z())};
+        if (grid.TileOf(center) != tile) continue;
+        if (max_distance > 0)
+        {
+            Neighbor_search search(tree, centroid, 1);
+            if (search.begin()->second > max_distance * max_distance) continue;
+        }
+        for (auto v : corners)
+        {
+            std::uint32_t &l = local[v.idx()];
+            if (l == unused)
+            {
+                const Point &p = mesh.point(v);
+                l = static_cast<std::uint32_t>(piece.vertices.size() / 3);
+                piece.vertices.insert(piece.vertices.end(), {float(p.x()), float(p.y()), float(p.z())});
+            }
+            piece.triangles.push_back(l);
+        }
+    }
+    piece.FindBorder();
+    return piece;
+}
+
+// Out-of-core mode: reconstructs overlapping tiles streamed from a tile-sorted copy of the point
+// cache in parallel, clips them to their own tile and welds the seams (see tiled_reconstruction.h)
+int ReconstructTiled(const PoissonOptions &options, StageReport &report)
+{
+    if (options.solver != "octree" && options.solver != "delaunay")
+    {
+        std::cerr << "unknown solver " << options.solver << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    report.Begin("load");
+    auto cache = std::make_unique<PointCache>(); // released once the tile-sorted copy is mapped
+    if (!cache->Load(options.input) || cache->channels() < 6)
+    {
+        std::cerr << "tiled reconstruction needs a point set with normals: " << options.input << std::endl;
+        return EXIT_FAILURE;
+    }
+    report.stage().Add("points", cache->size()).Add("normals", true);
+    report.End();
+    for (const char *stage : {"upsample", "clean", "normals", "orient"}) report.Skip(stage);
+
+    // tile-sorted copy next to the output, removed when done
+    report.Begin("partition");
+    const TileGrid grid(cache->bbox_min(), cache->bbox_max(), static_cast<int>(options.tiles), options.tile_overlap);
+    const std::string tiles_name = options.output + ".tiles.pcache";
+    std::vector<std::size_t> offsets;
+    auto tiled = std::make_unique<PointCache>();
+    if (!WriteTileSortedCache(*cache, grid, tiles_name, offsets) || !tiled->Map(tiles_name))
+    {
+        std::cerr << "Could not write " << tiles_name << std::endl;
+        return EXIT_FAILURE;
+    }
+    cache.reset();
+    std::size_t max_points = 0;
+    for (std::size_t t = 0; t < grid.count(); ++t) max_points = std::max(max_points, offsets[t + 1] - offsets[t]);
+    report.stage().Add("tiles", grid.count()).Add("tile_edge", double(grid.edge))
+                  .Add("tiled_points", tiled->size()).Add("max_tile_points", max_points);
+    report.End();
+
+    // solve + mesh, tile by tile
+    report.Begin("solve").Add("solver", options.solver).Add("tiles", grid.count());
+    const std::size_t min_points = 64; // fewer only happens for crumbs in the overlap
+    std::vector<TilePiece> pieces(grid.count());
+    std::vector<double> spacings(grid.count(), 0.0);
+    std::atomic<std::size_t> meshed(0), failed(0);
+    std::mutex log_mutex;
+    ParallelFor(grid.count(), static_cast<unsigned>(options.tile_jobs), [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t t = begin; t < end; ++t)
+        {
+            const std::size_t count = offsets[t + 1] - offsets[t];
+            if (count < min_points) continue;
+
+            // the tile is a contiguous range of the mapped channels
+            PointList points(count);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const std::size_t p = offsets[t] + i;
+                points[i].first = Point(tiled->channel(0)[p], tiled->channel(1)[p], tiled->channel(2)[p]);
+                points[i].second = Vector(tiled->channel(3)[p], tiled->channel(4)[p], tiled->channel(5)[p]);
+            }
+            CleanPoints(points, true);
+
+            Surface_mesh mesh;
+            FT spacing = 0;
+            bool ok = false;
+            if (options.solver == "octree")
+            {
+                OctreePoissonParams params = OctreeParams(options);
+                params.threads = 1;
+                OctreePoissonFunction<Kernel> function(points.begin(), points.end(), Point_map(), Normal_map(), params);
+                ok = ReconstructTile(function, true, points, options, mesh, spacing);
+            }
+            else
+            {
+                Poisson_reconstruction_function function(points.begin(), points.end(), Point_map(), Normal_map());
+                ok = ReconstructTile(function, kPoissonFunctionThreadSafe, points, options, mesh, spacing);
+            }
+            if (ok)
+            {
+                pieces[t] = ClipTile(mesh, grid, t, points, options.tile_trim * CGAL::to_double(spacing));
+                spacings[t] = CGAL::to_double(spacing);
+                ++meshed;
+            }
+            else
+                ++failed;
+
+            std::lock_guard<std::mutex> lock(log_mutex);
+            std::cout << "  tile " << t << ": " << count << " points, " << pieces[t].triangles.size() / 3 << " triangles"
+                      << (ok ? "" : " (failed)") << std::endl;
+        }
+    }, 1);
+    report.stage().Add("meshed_tiles", meshed.load()).Add("failed_tiles", failed.load());
+    report.End();
+    if (meshed == 0) return EXIT_FAILURE;
+
+    tiled.reset();
+    std::remove(tiles_name.c_str());
+
+    // weld the seams at about the largest triangle (facet_size spacings), the gap left by the clipping
+    report.Begin("mesh");
+    double spacing = 0;
+    for (double s : spacings) spacing += s;
+    spacing /= double(meshed.load());
+    SeamWelder welder(options.tile_weld * options.facet_size * spacing);
+    for (auto &piece : pieces)
+    {
+        welder.AddPiece(piece);
+        piece = TilePiece();
+    }
+    if (!welder.WriteOff(options.output))
+    {
+        std::cerr << "Could not write " << options.output << std::endl;
+        return EXIT_FAILURE;
+    }
+    report.stage().Add("vertices", welder.vertex_count()).Add("facets", welder.triangle_count())
+                  .Add("welded_vertices", welder.merged()).Add("collapsed_facets", welder.collapsed());
+    report.End();
+    report.Skip("evaluate"); // there is no in-memory point set to compare with
     return EXIT_SUCCESS;
 }
+
+int main(int argc, const char * argv[])
+{
+    PoissonOptions options;
+    if (!ParsePoissonOptions(argc, argv, options)) return EXIT_FAILURE;
+
+    StageReport report;
+    report.root().Add("input", options.input).Add("output", options.output).Add("parameters", ParametersJson(options));
+    auto finish = [&](int code)
+    {
+        report.root().Add("success", code == EXIT_SUCCESS);
+        if (!report.Write(options.report)) std::cerr << "Could not write " << options.report << std::endl;
+        else std::cout << "report: " << options.report << std::endl;
+        return code;
+    };
+
+    if (options.tiles > 0) return finish(ReconstructTiled(options, report));
+
+    // load
+    PointList points;
+    bool has_normals = false;
+    report.Begin("load");
+    if (!LoadPoints(options.input, points, has_normals)) return finish(EXIT_FAILURE);
+    report.stage().Add("points", points.size()).Add("normals", has_normals);
+    report.End();
+
+    // upsample, needs the normals of the input
+    if (options.upsample && has_normals)
+    {
+        report.Begin("upsample").Add("points_in", points.size());
+        PointList upsampled;
+        CGAL::edge_aware_upsample_point_set<CGAL::Parallel_if_available_tag>(
+            points,
+            std::back_inserter(upsampled),
+            CGAL::parameters::point_map(Point_map()).
+            normal_map(Normal_map()).
+            sharpness_angle(options.sharpness_angle).
+            edge_sensitivity(options.edge_sensitivity).
+            neighbor_radius(options.neighbor_radius).
+            number_of_output_points(static_cast<std::size_t>(points.size() * options.upsample_factor)));
+        points = std::move(upsampled);
+        report.stage().Add("points_out", points.size());
+        report.End();
+    }
+    else
+    {
+        if (options.upsample) std::cerr << "upsampling needs input normals, skipped" << std::endl;
+        report.Skip("upsample");
+    }
+
+    // clean: NaNs from upsampling, and zero normals unless they are estimated next
+    if (options.clean)
+    {
+        report.Begin("clean").Add("points_in", points.size());
+        const std::size_t removed = CleanPoints(points, !options.normals);
+        report.stage().Add("removed", removed).Add("points_out", points.size());
+        report.End();
+    }
+    else
+        report.Skip("clean");
+
+    // normals + orient share one kd-tree
+    std::unique_ptr<NormalsEngine<Kernel>> engine;
+    if (options.normals || options.orient)
+    {
+        std::vector<Point> positions;
+        positions.reserve(points.size());
+        for (const auto &pn : points) positions.push_back(pn.first);
+        engine = std::make_unique<NormalsEngine<Kernel>>(std::move(positions));
+        for (std::size_t i = 0; i < points.size(); ++i) engine->normals()[i] = points[i].second;
+    }
+    Neighborhood hood;
+    hood.k = static_cast<unsigned>(options.normals_k);
+    hood.radius = options.normals_radius;
+
+    if (options.normals)
+    {
+        NormalEstimator estimator;
+        if (!ParseNormalEstimator(options.estimator, estimator))
+        {
+            std::cerr << "unknown estimator " << options.estimator << std::endl;
+            return finish(EXIT_FAILURE);
+        }
+        report.Begin("normals").Add("points", points.size()).Add("estimator", options.estimator);
+        engine->BuildNeighborhoods(hood);
+        if (!engine->EstimateNormals(estimator)) return finish(EXIT_FAILURE);
+        report.End();
+    }
+    else
+        report.Skip("normals");
+
+    if (options.orient)
+    {
+        report.Begin("orient").Add("points_in", points.size());
+        if (!options.normals) engine->BuildNeighborhoods(hood);
+        const std::size_t unoriented = engine->OrientNormals(static_cast<std::size_t>(options.tile_points));
+        printf("Unoriented points: %zu of %zu (removed)\n", unoriented, points.size());
+        engine->RemoveUnoriented();
+        report.stage().Add("unoriented", unoriented).Add("points_out", engine->points().size());
+        report.End();
+    }
+    else
+        report.Skip("orient");
+
+    if (engine)
+    {
+        points.resize(engine->points().size());
+        for (std::size_t i = 0; i < points.size(); ++i)
+            points[i] = Point_with_normal(engine->points()[i], engine->normals()[i]);
+        engine.reset();
+    }
+
+    if (!options.solve)
+    {
+        report.Skip("solve");
+        report.Skip("mesh");
+        report.Skip("evaluate");
+        return finish(EXIT_SUCCESS);
+    }
+
+    // Creates implicit function from the points with the selected solver.
+    report.Begin("solve").Add("points", points.size()).Add("solver", options.solver);
+    int code = EXIT_FAILURE;
+    if (options.solver == "octree")
+    {
+        OctreePoissonFunction<Kernel> function(points.begin(), points.end(), Point_map(), Normal_map(),
+                                               OctreeParams(options));
+        code = SolveAndMesh(function, true, points, options, report);
+    }
+    else if (options.solver == "delaunay")
+    {
+        Poisson_reconstruction_function function(points.begin(), points.end(), Point_map(), Normal_map());
+        code = SolveAndMesh(function, kPoissonFunctionThreadSafe, points, options, report);
+    }
+    else
+        std::cerr << "unknown solver " << options.solver << std::endl;
+    return finish(code);
+}
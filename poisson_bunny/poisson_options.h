@@ -0,0 +1,255 @@
+#pragma once
+
+// Options of the poisson pipeline
+//   load -> upsample -> clean -> normals -> orient -> solve -> mesh -> evaluate
+//
+// Every option is "--name value" on the command line or "name = value" on a
+// line of a config file passed with --config ('#' starts a comment). They are
+// applied in order, so options after --config override the file.
+// --skip takes a comma separated list of stages; a skipped stage passes its
+// input through (skipping solve also skips mesh and evaluate).
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct PoissonOptions
+{
+    std::string input = "../bunny_with_normals.xyz";
+    std::string output = "bunny.off";
+    std::string report; // JSON stage report, <output>.json when empty
+    std::string eval_report; // JSON distances of the evaluate stage, <output>.eval.json when empty
+
+    // stages
+    bool upsample = true;
+    bool clean = true;
+    bool normals = true;
+    bool orient = true;
+    bool solve = true;
+    bool mesh = true;
+    bool evaluate = true;
+
+    // upsample (edge_aware_upsample_point_set)
+    double upsample_factor = 10.0;   // output points per input point
+    double sharpness_angle = 5.0;    // control sharpness of the result
+    double edge_sensitivity = 0.1;   // higher values will sample more points near the edges
+    double neighbor_radius = 0.2;    // initial size of neighborhood
+
+    // normals / orient
+    std::string estimator = "jet";   // pca, jet or vcm
+    double normals_k = 24;           // neighbors for estimation and orientation
+    double normals_radius = 0.0;     // > 0: neighbors within this radius (capped to normals_k)
+    double tile_points = 0;          // > 0: tiled parallel orientation
+
+    // solve
+    std::string solver = "delaunay"; // delaunay (Poisson_reconstruction_function) or octree (multigrid)
+    double spacing_k = 6;            // neighbors for the average spacing (1 ring)
+    double octree_depth = 8;         // finest octree level
+    double octree_dense_depth = 6;   // octree levels covering the whole domain
+    double octree_band = 2;          // cells kept around the samples above the dense levels
+
+    // tiled (out-of-core) reconstruction, replaces the stages up to mesh
+    double tiles = 0;                // > 0: tiles along the longest bbox axis
+    double tile_overlap = 0.25;      // points gathered around each tile, w.r.t. the tile edge
+    double tile_jobs = 0;            // tiles reconstructed at once (0 = all cores)
+    double tile_trim = 3;            // drop triangles farther than this * spacing from the points (0 = off)
+    double tile_weld = 1.0;          // seam weld distance w.r.t. the largest triangle (facet_size)
+
+    // mesh (Mesh_3 criteria)
+    double facet_angle = 20.0;       // min triangle angle in degrees
+    double facet_size = 0.5;         // max triangle size w.r.t. point set average spacing
+    double facet_distance = 0.1;     // surface approximation error w.r.t. point set average spacing
+    double eval_cache = 1;           // != 0: memoize implicit function values during meshing
+    double mesh_threads = 0;         // meshing threads with TBB (0 = all cores, 1 = sequential)
+    double deterministic = 0;        // != 0: sequential meshing with a fixed seed, for regression runs
+
+    // evaluate
+    double eval_samples = 100000;    // surface samples for the mesh -> points distances
+};
+
+// One settable option: name and the field it writes
+struct PoissonOption
+{
+    const char *name;
+    double *number;
+    std::string *text;
+    const char *help;
+};
+
+inline std::vector<PoissonOption> PoissonOptionTable(PoissonOptions &o)
+{
+    return {
+        {"input", nullptr, &o.input, "point set with normals (.xyz, or a .pcache)"},
+        {"output", nullptr, &o.output, "reconstructed mesh (.off)"},
+        {"report", nullptr, &o.report, "JSON stage report (default <output>.json)"},
+        {"eval-report", nullptr, &o.eval_report, "JSON distances of the evaluation (default <output>.eval.json)"},
+        {"upsample-factor", &o.upsample_factor, nullptr, "upsampled points per input point"},
+        {"sharpness-angle", &o.sharpness_angle, nullptr, "upsampling sharpness angle (degrees)"},
+        {"edge-sensitivity", &o.edge_sensitivity, nullptr, "upsampling density near edges"},
+        {"neighbor-radius", &o.neighbor_radius, nullptr, "upsampling initial neighborhood radius"},
+        {"estimator", nullptr, &o.estimator, "normal estimator: pca, jet or vcm"},
+        {"normals-k", &o.normals_k, nullptr, "neighbors for normal estimation and orientation"},
+        {"normals-radius", &o.normals_radius, nullptr, "neighborhood radius instead of k (0 = off)"},
+        {"tile-points", &o.tile_points, nullptr, "points per orientation tile (0 = one MST)"},
+        {"solver", nullptr, &o.solver, "implicit function: delaunay or octree"},
+        {"spacing-k", &o.spacing_k, nullptr, "neighbors for the average spacing"},
+        {"octree-depth", &o.octree_depth, nullptr, "octree solver: finest level"},
+        {"octree-dense-depth", &o.octree_dense_depth, nullptr, "octree solver: levels covering the whole domain"},
+        {"octree-band", &o.octree_band, nullptr, "octree solver: cells kept around the samples"},
+        {"tiles", &o.tiles, nullptr, "out-of-core mode: tiles along the longest axis (0 = off)"},
+        {"tile-overlap", &o.tile_overlap, nullptr, "overlap around each tile / tile edge"},
+        {"tile-jobs", &o.tile_jobs, nullptr, "tiles reconstructed at once (0 = all cores)"},
+        {"tile-trim", &o.tile_trim, nullptr, "max triangle distance to the points / spacing (0 = off)"},
+        {"tile-weld", &o.tile_weld, nullptr, "seam weld distance / largest triangle (facet-size)"},
+        {"facet-angle", &o.facet_angle, nullptr, "min triangle angle (degrees)"},
+        {"facet-size", &o.facet_size, nullptr, "max triangle size / average spacing"},
+        {"facet-distance", &o.facet_distance, nullptr, "max approximation error / average spacing"},
+        {"mesh-threads", &o.mesh_threads, nullptr, "meshing threads, needs TBB (0 = all cores, 1 = sequential)"},
+        {"deterministic", &o.deterministic, nullptr, "reproducible meshes: sequential, fixed seed (0 = off)"},
+        {"eval-cache", &o.eval_cache, nullptr, "cache function values while meshing (0 = off)"},
+        {"eval-samples", &o.eval_samples, nullptr, "surface samples for the mesh -> points distances"},
+    };
+}
+
+inline void PrintPoissonUsage(PoissonOptions &o)
+{
+    std::cout << "usage: poisson [--config file] [--skip stage,...] [--name value ...] [input]\n"
+              << "stages: upsample clean normals orient solve mesh evaluate\n";
+    for (const PoissonOption &opt : PoissonOptionTable(o))
+    {
+        std::cout << "  --" << opt.name << " (";
+        if (opt.number)
+            std::cout << *opt.number;
+        else
+            std::cout << (opt.text->empty() ? "-" : *opt.text);
+        std::cout << "): " << opt.help << "\n";
+    }
+}
+
+inline bool SetPoissonStages(PoissonOptions &o, const std::string &list, bool enabled)
+{
+    std::stringstream ss(list);
+    std::string stage;
+    while (std::getline(ss, stage, ','))
+    {
+        if (stage == "upsample") o.upsample = enabled;
+        else if (stage == "clean") o.clean = enabled;
+        else if (stage == "normals") o.normals = enabled;
+        else if (stage == "orient") o.orient = enabled;
+        else if (stage == "solve") o.solve = enabled;
+        else if (stage == "mesh") o.mesh = enabled;
+        else if (stage == "evaluate") o.evaluate = enabled;
+        else
+        {
+            std::cerr << "unknown stage " << stage << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LoadPoissonConfig(const std::string &filename, PoissonOptions &o);
+
+inline bool SetPoissonOption(PoissonOptions &o, const std::string &name, const std::string &value)
+{
+    if (name == "config") return LoadPoissonConfig(value, o);
+    if (name == "skip") return SetPoissonStages(o, value, false);
+    for (const PoissonOption &opt : PoissonOptionTable(o))
+    {
+        if (name != opt.name) continue;
+        if (opt.text)
+        {
+            *opt.text = value;
+            return true;
+        }
+        char *end = nullptr;
+        const double v = std::strtod(value.c_str(), &end);
+        if (value.empty() || *end != '\0')
+        {
+            std::cerr << "--" << name << " expects a number, got " << value << std::endl;
+            return false;
+        }
+        *opt.number = v;
+        return true;
+    }
+    std::cerr << "unknown option " << name << std::endl;
+    return false;
+}
+
+inline bool LoadPoissonConfig(const std::string &filename, PoissonOptions &o)
+{
+    std::ifstream in(filename);
+    if (!in)
+    {
+        std::cerr << "cannot read config " << filename << std::endl;
+        return false;
+    }
+    auto trim = [](std::string s)
+    {
+        const std::size_t b = s.find_first_not_of(" \t\r");
+        const std::size_t e = s.find_last_not_of(" \t\r");
+        return b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+    };
+    std::string line;
+    while (std::getline(in, line))
+    {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        const std::size_t eq = line.find('=');
+        if (eq == std::string::npos)
+        {
+            std::cerr << filename << ": expected name = value, got " << line << std::endl;
+            return false;
+        }
+        if (!SetPoissonOption(o, trim(line.substr(0, eq)), trim(line.substr(eq + 1)))) return false;
+    }
+    return true;
+}
+
+// false on errors or --help. For compatibility, three bare numbers are
+// facet-angle facet-size facet-distance.
+inline bool ParsePoissonOptions(int argc, const char *argv[], PoissonOptions &o)
+{
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h")
+        {
+            PrintPoissonUsage(o);
+            return false;
+        }
+        if (arg.compare(0, 2, "--") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << arg << " expects a value" << std::endl;
+                return false;
+            }
+            if (!SetPoissonOption(o, arg.substr(2), argv[++i])) return false;
+        }
+        else
+            positional.push_back(arg);
+    }
+    if (positional.size() == 3)
+    {
+        o.facet_angle = std::atof(positional[0].c_str());
+        o.facet_size = std::atof(positional[1].c_str());
+        o.facet_distance = std::atof(positional[2].c_str());
+    }
+    else if (positional.size() == 1)
+        o.input = positional[0];
+    else if (!positional.empty())
+    {
+        std::cerr << "unexpected arguments, see --help" << std::endl;
+        return false;
+    }
+    if (o.report.empty()) o.report = o.output + ".json";
+    if (o.eval_report.empty()) o.eval_report = o.output + ".eval.json";
+    if (!o.solve) o.mesh = false;
+    if (!o.mesh) o.evaluate = false;
+    return true;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+// Per-stage timing / memory report of the poisson pipeline, written as JSON:
+//
+//   {
+//     "input": "...", "parameters": {...},
+//     "stages": [
+//       {"name": "upsample", "skipped": false, "seconds": 1.2, "peak_rss_mb": 310.5,
+//        "points_in": 35947, "points_out": 359470},
+//       ...
+//     ],
+//     "total_seconds": ..., "peak_rss_mb": ...
+//   }
+//
+// Peak RSS is the process high-water mark (getrusage) when the stage ends, so it
+// only grows; a stage that raises it is the one that needed the memory.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+inline double PeakRssMb()
+{
+#ifndef _WIN32
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+    return usage.ru_maxrss / 1024.0; // kilobytes
+#endif
+#else
+    return 0.0;
+#endif
+}
+
+// Ordered JSON object built from already formatted values
+class JsonObject
+{
+public:
+    JsonObject &Add(const std::string &key, double value)
+    {
+        if (!std::isfinite(value)) return Raw(key, "null");
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+        return Raw(key, buffer);
+    }
+    JsonObject &Add(const std::string &key, std::size_t value) { return Raw(key, std::to_string(value)); }
+    JsonObject &Add(const std::string &key, bool value) { return Raw(key, value ? "true" : "false"); }
+    JsonObject &Add(const std::string &key, const char *value) { return Raw(key, Quote(value)); }
+    JsonObject &Add(const std::string &key, const std::string &value) { return Raw(key, Quote(value)); }
+    JsonObject &Add(const std::string &key, const JsonObject &value) { return Raw(key, value.str()); }
+    JsonObject &Add(const std::string &key, const std::vector<JsonObject> &values)
+    {
+        std::string array = "[";
+        for (std::size_t i = 0; i < values.size(); ++i) array += (i ? ", " : "") + values[i].str();
+        return Raw(key, array + "]");
+    }
+
+    // Replace the value of key if present, append it otherwise
+    JsonObject &Raw(const std::string &key, const std::string &json)
+    {
+        for (auto &member : members_)
+            if (member.first == key)
+            {
+                member.second = json;
+                return *this;
+            }
+        members_.emplace_back(key, json);
+        return *this;
+    }
+
+    std::string str() const
+    {
+        std::string out = "{";
+        for (std::size_t i = 0; i < members_.size(); ++i)
+            out += (i ? ", " : "") + Quote(members_[i].first) + ": " + members_[i].second;
+        return out + "}";
+    }
+
+    static std::string Quote(const std::string &s)
+    {
+        std::string out = "\"";
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\') out += '\\';
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char buffer[8];
+                std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                out += buffer;
+                continue;
+            }
+            out += c;
+        }
+        return out + "\"";
+    }
+
+private:
+    std::vector<std::pair<std::string, std::string>> members_;
+};
+
+class StageReport
+{
+public:
+    StageReport() : start_(std::chrono::steady_clock::now()) {}
+
+    // Start timing a stage; counts go to it until End()
+    JsonObject &Begin(const std::string &name)
+    {
+        std::cout << "[" << name << "]" << std::endl;
+        stages_.emplace_back();
+        stages_.back().Add("name", name).Add("skipped", false);
+        stage_start_ = std::chrono::steady_clock::now();
+        return stages_.back();
+    }
+
+    void End()
+    {
+        const double seconds = Seconds(stage_start_);
+        const double rss = PeakRssMb();
+        stages_.back().Add("seconds", seconds).Add("peak_rss_mb", rss);
+        std::cout << "  " << seconds << " s, peak RSS " << rss << " MB" << std::endl;
+    }
+
+    void Skip(const std::string &name)
+    {
+        stages_.emplace_back();
+        stages_.back().Add("name", name).Add("skipped", true);
+    }
+
+    // The current stage, for counts
+    JsonObject &stage() { return stages_.back(); }
+    // Top-level members (input, parameters, results)
+    JsonObject &root() { return root_; }
+
+    bool Write(const std::string &filename)
+    {
+        JsonObject report = root_;
+        report.Add("stages", stages_).Add("total_seconds", Seconds(start_)).Add("peak_rss_mb", PeakRssMb());
+        std::ofstream out(filename);
+        out << report.str() << "\n";
+        return bool(out);
+    }
+
+private:
+    static double Seconds(std::chrono::steady_clock::time_point since)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+    }
+
+    JsonObject root_;
+    std::vector<JsonObject> stages_;
+    std::chrono::steady_clock::time_point start_, stage_start_;
+};
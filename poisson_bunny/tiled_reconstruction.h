@@ -0,0 +1,305 @@
+#pragma once
+
+// Building blocks of the out-of-core (tiled) Poisson reconstruction.
+//
+// The bounding box of the cloud is cut into a grid of cubic tiles. Every tile
+// is reconstructed from the points of its box grown by an overlap margin, so the
+// surface is well supported up to the tile border; only the triangles whose
+// centroid falls in the tile itself are kept. The pieces are then welded into
+// one mesh: only the vertices on the clip border of a piece are welded, each to
+// the nearest border vertex of another tile within the weld distance, so the
+// interior of every piece stays as meshed. The pieces are meshed independently,
+// so the seam between them is up to one triangle wide; a weld distance of about
+// the largest triangle closes most of it, slivers can remain.
+//
+// The points are never all in memory: one streaming pass over the mapped point
+// cache writes a tile-sorted copy of it to disk (overlap points once per tile),
+// in which every tile is a contiguous range, paged in when the tile is meshed.
+
+#include "point_cache.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct TileGrid
+{
+    float lo[3] = {0, 0, 0};   // bbox min
+    float edge = 1;            // tile edge length
+    float margin = 0;          // overlap added around every tile
+    int dims[3] = {1, 1, 1};
+
+    // Cubic tiles, tiles_along_longest of them on the longest bbox axis
+    TileGrid(const float *bbox_min, const float *bbox_max, int tiles_along_longest, double overlap)
+    {
+        float longest = 0;
+        for (int k = 0; k < 3; ++k) longest = std::max(longest, bbox_max[k] - bbox_min[k]);
+        edge = std::max(longest, 1e-6f) / std::max(tiles_along_longest, 1);
+        margin = static_cast<float>(overlap) * edge;
+        for (int k = 0; k < 3; ++k)
+        {
+            lo[k] = bbox_min[k];
+            dims[k] = std::max(1, static_cast<int>(std::ceil((bbox_max[k] - bbox_min[k]) / edge - 1e-4f)));
+        }
+    }
+
+    std::size_t count() const { return std::size_t(dims[0]) * dims[1] * dims[2]; }
+
+    // Tile coordinate of x on axis k, clamped into the grid
+    int Cell(int k, float x) const
+    {
+        const int c = static_cast<int>(std::floor((x - lo[k]) / edge));
+        return std::min(std::max(c, 0), dims[k] - 1);
+    }
+    std::size_t Index(int i, int j, int k) const { return (std::size_t(k) * dims[1] + j) * dims[0] + i; }
+
+    // The tile that owns point p (triangle centroids beyond the bbox go to the border tiles)
+    std::size_t TileOf(const float p[3]) const { return Index(Cell(0, p[0]), Cell(1, p[1]), Cell(2, p[2])); }
+};
+
+namespace tiled_detail
+{
+inline bool Seek(std::FILE *file, std::uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+// calls fn(tile) for every tile whose grown box holds point i; NaN points have none
+template <class Fn>
+void ForTiles(const TileGrid &grid, const float *const x[3], std::size_t i, Fn &&fn)
+{
+    int first[3], last[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        if (std::isnan(x[k][i])) return;
+        first[k] = grid.Cell(k, x[k][i] - grid.margin);
+        last[k] = grid.Cell(k, x[k][i] + grid.margin);
+    }
+    for (int c = first[2]; c <= last[2]; ++c)
+        for (int b = first[1]; b <= last[1]; ++b)
+            for (int a = first[0]; a <= last[0]; ++a) fn(grid.Index(a, b, c));
+}
+} // namespace tiled_detail
+
+// Writes the points of every tile (overlap included) to filename, a point cache
+// with the channels of cache in which tile t holds points [offsets[t], offsets[t + 1]).
+// Two streaming passes (count, write); per tile and channel a small buffer is
+// flushed to its place in the file, buffer_bytes in total.
+inline bool WriteTileSortedCache(const PointCache &cache, const TileGrid &grid, const std::string &filename,
+                                 std::vector<std::size_t> &offsets, std::size_t buffer_bytes = std::size_t(64) << 20)
+{
+    using namespace tiled_detail;
+    const float *x[3] = {cache.channel(0), cache.channel(1), cache.channel(2)};
+    const std::size_t n = cache.size();
+    const std::size_t channels = cache.channels();
+    const std::size_t tiles = grid.count();
+
+    offsets.assign(tiles + 1, 0);
+    for (std::size_t i = 0; i < n; ++i) ForTiles(grid, x, i, [&](std::size_t t) { ++offsets[t + 1]; });
+    for (std::size_t t = 0; t < tiles; ++t) offsets[t + 1] += offsets[t];
+    const std::size_t total = offsets.back();
+
+    PointCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "PCACHE", 6);
+    header.version = PointCache::kVersion;
+    header.channels = static_cast<std::uint32_t>(channels);
+    header.count = total;
+    std::memcpy(header.bbox_min, cache.bbox_min(), sizeof(header.bbox_min));
+    std::memcpy(header.bbox_max, cache.bbox_max(), sizeof(header.bbox_max));
+
+    const std::string tmp_name = filename + ".tmp";
+    std::FILE *file = std::fopen(tmp_name.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+    // buffer of (tile, channel) b holds values for positions written[b] ... of its range
+    const std::size_t per_buffer = std::max<std::size_t>(buffer_bytes / (sizeof(float) * tiles * channels), 256);
+    std::vector<float> buffers(per_buffer * tiles * channels);
+    std::vector<std::size_t> used(tiles * channels, 0), written(tiles * channels, 0);
+    auto flush = [&](std::size_t t, std::size_t k)
+    {
+        const std::size_t b = t * channels + k;
+        if (used[b] == 0) return;
+        const std::size_t value = k * total + offsets[t] + written[b];
+        ok &= Seek(file, sizeof(header) + value * sizeof(float));
+        ok &= std::fwrite(&buffers[b * per_buffer], sizeof(float), used[b], file) == used[b];
+        written[b] += used[b];
+        used[b] = 0;
+    };
+    for (std::size_t i = 0; i < n && ok; ++i)
+        ForTiles(grid, x, i, [&](std::size_t t)
+        {
+            for (std::size_t k = 0; k < channels; ++k)
+            {
+                const std::size_t b = t * channels + k;
+                if (used[b] == per_buffer) flush(t, k);
+                buffers[b * per_buffer + used[b]++] = cache.channel(k)[i];
+            }
+        });
+    for (std::size_t t = 0; t < tiles; ++t)
+        for (std::size_t k = 0; k < channels; ++k) flush(t, k);
+    ok &= std::fclose(file) == 0;
+    if (!ok || std::rename(tmp_name.c_str(), filename.c_str()) != 0)
+    {
+        std::remove(tmp_name.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Clipped mesh of one tile: vertices (xyz), triangles over them and a flag per
+// vertex that lies on a border edge (an edge of only one kept triangle)
+struct TilePiece
+{
+    std::vector<float> vertices;
+    std::vector<std::uint32_t> triangles;
+    std::vector<char> border;
+
+    // flag the border vertices from the triangles
+    void FindBorder()
+    {
+        std::unordered_map<std::uint64_t, int> edges;
+        for (std::size_t i = 0; i < triangles.size(); i += 3)
+            for (int e = 0; e < 3; ++e)
+            {
+                const std::uint64_t a = triangles[i + e], b = triangles[i + (e + 1) % 3];
+                ++edges[std::min(a, b) << 32 | std::max(a, b)];
+            }
+        border.assign(vertices.size() / 3, 0);
+        for (const auto &edge : edges)
+            if (edge.second == 1)
+            {
+                border[edge.first >> 32] = 1;
+                border[edge.first & 0xffffffffu] = 1;
+            }
+    }
+};
+
+// Joins the tile pieces into one mesh, welding border vertices across tiles
+class SeamWelder
+{
+public:
+    explicit SeamWelder(double weld_distance) : cell_(static_cast<float>(std::max(weld_distance, 1e-12))) {}
+
+    void AddPiece(const TilePiece &piece)
+    {
+        const std::uint32_t id = pieces_++;
+        std::vector<std::uint32_t> remap(piece.vertices.size() / 3);
+        for (std::size_t v = 0; v < remap.size(); ++v)
+        {
+            const float *p = &piece.vertices[3 * v];
+            if (piece.border[v])
+            {
+                const std::uint32_t match = Nearest(p, id);
+                if (match != kNone)
+                {
+                    remap[v] = match;
+                    ++merged_;
+                    continue;
+                }
+            }
+            remap[v] = static_cast<std::uint32_t>(vertex_count());
+            vertices_.insert(vertices_.end(), p, p + 3);
+            if (piece.border[v]) grid_[Key(p)].push_back({remap[v], id});
+        }
+        for (std::size_t i = 0; i + 2 < piece.triangles.size(); i += 3)
+        {
+            const std::uint32_t v[3] = {remap[piece.triangles[i]], remap[piece.triangles[i + 1]],
+                                        remap[piece.triangles[i + 2]]};
+            if (v[0] == v[1] || v[1] == v[2] || v[0] == v[2])
+            {
+                ++collapsed_; // two border corners welded to the same vertex
+                continue;
+            }
+            triangles_.insert(triangles_.end(), v, v + 3);
+        }
+    }
+
+    std::size_t vertex_count() const { return vertices_.size() / 3; }
+    std::size_t triangle_count() const { return triangles_.size() / 3; }
+    std::size_t merged() const { return merged_; }
+    std::size_t collapsed() const { return collapsed_; }
+
+    bool WriteOff(const std::string &filename) const
+    {
+        std::ofstream out(filename);
+        out.precision(9);
+        out << "OFF\n" << vertex_count() << " " << triangle_count() << " 0\n";
+        for (std::size_t i = 0; i < vertices_.size(); i += 3)
+            out << vertices_[i] << " " << vertices_[i + 1] << " " << vertices_[i + 2] << "\n";
+        for (std::size_t i = 0; i < triangles_.size(); i += 3)
+            out << "3 " << triangles_[i] << " " << triangles_[i + 1] << " " << triangles_[i + 2] << "\n";
+        return bool(out);
+    }
+
+private:
+    static constexpr std::uint32_t kNone = std::numeric_limits<std::uint32_t>::max();
+
+    struct BorderVertex
+    {
+        std::uint32_t vertex;
+        std::uint32_t piece;
+    };
+
+    struct CellHash
+    {
+        std::size_t operator()(const std::array<std::int64_t, 3> &c) const
+        {
+            return std::size_t(c[0] * 73856093ll ^ c[1] * 19349663ll ^ c[2] * 83492791ll);
+        }
+    };
+
+    std::array<std::int64_t, 3> Key(const float *p) const
+    {
+        return {static_cast<std::int64_t>(std::floor(p[0] / cell_)), static_cast<std::int64_t>(std::floor(p[1] / cell_)),
+                static_cast<std::int64_t>(std::floor(p[2] / cell_))};
+    }
+
+    // nearest border vertex of another piece within the weld distance
+    std::uint32_t Nearest(const float *p, std::uint32_t piece) const
+    {
+        const std::array<std::int64_t, 3> key = Key(p);
+        std::uint32_t best = kNone;
+        float best_d2 = cell_ * cell_;
+        for (int dz = -1; dz <= 1; ++dz)
+            for (int dy = -1; dy <= 1; ++dy)
+                for (int dx = -1; dx <= 1; ++dx)
+                {
+                    auto it = grid_.find({key[0] + dx, key[1] + dy, key[2] + dz});
+                    if (it == grid_.end()) continue;
+                    for (const BorderVertex &b : it->second)
+                    {
+                        if (b.piece == piece) continue;
+                        const float *q = &vertices_[3 * std::size_t(b.vertex)];
+                        const float d2 = (p[0] - q[0]) * (p[0] - q[0]) + (p[1] - q[1]) * (p[1] - q[1]) +
+                                         (p[2] - q[2]) * (p[2] - q[2]);
+                        if (d2 <= best_d2)
+                        {
+                            best_d2 = d2;
+                            best = b.vertex;
+                        }
+                    }
+                }
+        return best;
+    }
+
+    float cell_;
+    std::uint32_t pieces_ = 0;
+    std::vector<float> vertices_;
+    std::vector<std::uint32_t> triangles_;
+    std::unordered_map<std::array<std::int64_t, 3>, std::vector<BorderVertex>, CellHash> grid_;
+    std::size_t merged_ = 0, collapsed_ = 0;
+};
@@ -8,6 +8,9 @@
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_opengl3.h"
 
+#include "background_job.h"
+#include "gl_buffers.h"
+
 #include <vector>
 #include <cmath>
 #include <iostream>
@@ -18,8 +21,8 @@ typedef Kernel_t::Point_2 Point;
 typedef Kernel_t::Segment_2 Segment;
 typedef Kernel_t::Ray_2 Ray;
 
-static Delaunay dt;
 static std::vector<Point> points;
+static bool recompute = true;
 
 static int window_width = 900; 
 static int window_height = 600;
@@ -33,11 +36,52 @@ Point ScreenToWorld(double xpos, double ypos)
     return Point(x, y);
 }
 
+// Line segments (pairs of endpoints) of both diagrams, extracted on the worker thread
+struct DiagramLines
+{
+    std::vector<Point> delaunay;
+    std::vector<Point> voronoi;
+};
+
+DiagramLines BuildDiagrams(const std::vector<Point> &pts, const JobToken &token)
+{
+    DiagramLines lines;
+    Delaunay dt;
+    if (!pts.empty())
+        dt.insert(pts.begin(), pts.end());
+    if (token.Cancelled()) return lines;
+
+    for (auto e = dt.finite_edges_begin(); e != dt.finite_edges_end(); ++e)
+    {
+        Segment s = dt.segment(*e);
+        lines.delaunay.push_back(s.source());
+        lines.delaunay.push_back(s.target());
+    }
+    if (token.Cancelled()) return lines;
+
+    for (auto e = dt.finite_edges_begin(); e != dt.finite_edges_end(); ++e)
+    {
+        CGAL::Object o = dt.dual(e);
+        if (const Segment *s = CGAL::object_cast<Segment>(&o))
+        {
+            lines.voronoi.push_back(s->source());
+            lines.voronoi.push_back(s->target());
+        }
+        else if (const Kernel_t::Ray_2 *r = CGAL::object_cast<Kernel_t::Ray_2>(&o))
+        {
+            // Clip to a box [0,1]^2 for visualization
+            Point src = r->source();
+            Point dir = src + 0.5 * (r->to_vector() / std::sqrt(r->to_vector().squared_length()));
+            lines.voronoi.push_back(src);
+            lines.voronoi.push_back(dir);
+        }
+    }
+    return lines;
+}
+
 void Recompute()
 {
-    dt.clear();
-    if (!points.empty())
-        dt.insert(points.begin(), points.end());
+    recompute = true;
 }
 
 void MouseBtnCB(GLFWwindow *window, int button, int action, int mods)
@@ -79,54 +123,24 @@ void MouseBtnCB(GLFWwindow *window, int button, int action, int mods)
     }
 }
 
-void DrawDelaunay(const Delaunay &dt)
+// Geometry is uploaded when it changes (see main), drawing is one call each
+void DrawDelaunay(const GeometryBuffer &lines_gpu)
 {
     glColor3f(0.2f, 0.6f, 1.0f);
-    glBegin(GL_LINES);
-    for (auto f = dt.finite_faces_begin(); f != dt.finite_faces_end(); ++f)
-    {
-        for (int i = 0; i < 3; ++i)
-        {
-            Point a = f->vertex(i)->point();
-            Point b = f->vertex((i + 1) % 3)->point();
-            glVertex2f(a.x(), a.y());
-            glVertex2f(b.x(), b.y());
-        }
-    }
-    glEnd();
+    lines_gpu.DrawArrays(GL_LINES);
 }
 
-void DrawVoronoi(const Delaunay &dt)
+void DrawVoronoi(const GeometryBuffer &lines_gpu)
 {
     glColor3f(1.0f, 0.85f, 0.1f);
-    glBegin(GL_LINES);
-    for (auto e = dt.finite_edges_begin(); e != dt.finite_edges_end(); ++e)
-    {
-        CGAL::Object o = dt.dual(e);
-        if (const Segment *s = CGAL::object_cast<Segment>(&o))
-        {
-            glVertex2f(s->source().x(), s->source().y());
-            glVertex2f(s->target().x(), s->target().y());
-        }
-        else if (const Kernel_t::Ray_2 *r = CGAL::object_cast<Kernel_t::Ray_2>(&o))
-        {
-            // Clip to a box [0,1]^2 for visualization
-            Point src = r->source();
-            Point dir = src + 0.5 * (r->to_vector() / std::sqrt(r->to_vector().squared_length()));
-            glVertex2f(src.x(), src.y());
-            glVertex2f(dir.x(), dir.y());
-        }
-    }
-    glEnd();
+    lines_gpu.DrawArrays(GL_LINES);
 }
 
-void DrawPoints()
+void DrawPoints(const GeometryBuffer &points_gpu)
 {
     glPointSize(6.0f);
     glColor3f(1.0f, 0.3f, 0.3f);
-    glBegin(GL_POINTS);
-    for (auto &p : points) glVertex2f(p.x(), p.y());
-    glEnd();
+    points_gpu.DrawArrays(GL_POINTS);
 }
 
 int main()
@@ -145,12 +159,27 @@ int main()
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 330");
 
-    Recompute();
+    // triangulation runs on a worker thread, finished diagrams are swapped into lines
+    BackgroundJob<std::vector<Point>, DiagramLines> diagram_job(BuildDiagrams);
+    DiagramLines lines;
+    GeometryBuffer points_gpu, delaunay_gpu, voronoi_gpu;
 
     while (!glfwWindowShouldClose(window))
     {
         glfwPollEvents();
 
+        if (recompute)
+        {
+            diagram_job.Submit(points);
+            points_gpu.SetVertices(FlattenPoints2(points), 2);
+            recompute = false;
+        }
+        if (diagram_job.Poll(lines))
+        {
+            delaunay_gpu.SetVertices(FlattenPoints2(lines.delaunay), 2);
+            voronoi_gpu.SetVertices(FlattenPoints2(lines.voronoi), 2);
+        }
+
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -167,6 +196,8 @@ int main()
             points.clear();
             Recompute();
         }
+        if (diagram_job.Busy())
+            ImGui::Text("computing...");
         ImGui::End();
 
         // --- OpenGL rendering ---
@@ -180,9 +211,9 @@ int main()
         glMatrixMode(GL_MODELVIEW);
         glLoadIdentity();
 
-        DrawPoints();
-        if (show_delaunay) DrawDelaunay(dt);
-        if (show_voronoi) DrawVoronoi(dt);
+        DrawPoints(points_gpu);
+        if (show_delaunay) DrawDelaunay(delaunay_gpu);
+        if (show_voronoi) DrawVoronoi(voronoi_gpu);
 
         // Render ImGui overlay
         ImGui::Render();
@@ -191,6 +222,9 @@ int main()
     }
 
     // Cleanup
+    points_gpu.Release();
+    delaunay_gpu.Release();
+    voronoi_gpu.Release();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();